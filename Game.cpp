@@ -12,6 +12,7 @@
 #include "pch.h"
 
 #include "Game.h"
+#include "SpoutStereoTrace.h"
 
 #include <windows.h>
 #include <stdio.h>
@@ -129,10 +130,14 @@ Game::Game() noexcept :
     m_width = ConfigVal::Get("WINDOW_WIDTH", 1280);
     m_height = ConfigVal::Get("WINDOW_HEIGHT", 1280);
     m_stereo = ConfigVal::Get("WINDOW_STEREO", true);
+
+    SpoutStereoTrace::Initialize();
+    SpoutStereoTrace::SetThreadName("Main loop");
 }
 
 Game::~Game() {
-
+    // Keep the last TRACE_MAX_EVENTS events of the session
+    SpoutStereoTrace::Flush();
 }
 
 void Game::GetDefaultSize(int& width, int& height) const noexcept
@@ -148,7 +153,10 @@ void Game::Initialize(HWND window)
     m_window = window;
     m_spoutStereoWindow.Initialize(window, m_stereo); // blank name because only one window
 
-    CreateDevice();
+    // The null graphics backend runs the frame loop without a D3D11 device or swap chain
+    if (!m_spoutStereoWindow.headless()) {
+        CreateDevice();
+    }
     CreateDeviceResources();
     CreateWindowResources();
 
@@ -262,6 +270,11 @@ void Game::CreateWindowResources()
 {
     // TODO: Initialize window dependent objects here
 
+    if (m_spoutStereoWindow.headless()) {
+        m_spoutStereoWindow.CreateWindowResources();
+        return;
+    }
+
     const UINT backBufferWidth = static_cast<UINT>(m_width);
     const UINT backBufferHeight = static_cast<UINT>(m_height);
     const DXGI_FORMAT backBufferFormat = DXGI_FORMAT_B8G8R8A8_UNORM;
@@ -355,6 +368,10 @@ void Game::ReleaseWindowResources()
 {
     m_spoutStereoWindow.ReleaseWindowResources();
 
+    if (m_spoutStereoWindow.headless()) {
+        return;
+    }
+
     // Clear the previous window size specific context.
     m_d3dContext->OMSetRenderTargets(0, nullptr, nullptr);
     m_renderTargetViewLeft.Reset();
@@ -376,7 +393,9 @@ void Game::ResetDevice()
     ReleaseDeviceResources();
     ReleaseDevice();
 
-    CreateDevice();
+    if (!m_spoutStereoWindow.headless()) {
+        CreateDevice();
+    }
     CreateDeviceResources();
     CreateWindowResources();
 }
@@ -384,6 +403,8 @@ void Game::ResetDevice()
 // Executes the basic game loop.
 void Game::Tick()
 {
+    SPOUT_TRACE_ZONE("Tick");
+
     m_timer.Tick([&]()
     {
         Update(m_timer);
@@ -398,6 +419,8 @@ void Game::Update(DX::StepTimer const& timer)
 {
     //float elapsedTime = float(timer.GetElapsedSeconds());
 
+    SPOUT_TRACE_ZONE("Update");
+
     m_spoutStereoWindow.Update();
 
     if (m_spoutStereoWindow.requiresDeviceReset()) {
@@ -414,7 +437,23 @@ void Game::Render()
         return;
     }
 
-    m_spoutStereoWindow.Draw(m_renderTargetViewLeft, m_renderTargetViewRight);
+    // With DAMAGE_TRACKING a frame in which nothing changed is neither drawn nor presented
+    if (!m_spoutStereoWindow.NeedsDraw()) {
+        SPOUT_TRACE_ZONE("SkipFrame");
+        m_spoutStereoWindow.SkipFrame(m_swapChain.Get());
+        return;
+    }
+
+    {
+        SPOUT_TRACE_ZONE("Draw");
+        m_spoutStereoWindow.Draw(m_renderTargetViewLeft, m_renderTargetViewRight);
+    }
+
+    // With FRAME_PACER_FPS the frame is presented at its deadline instead of on VSync
+    {
+        SPOUT_TRACE_ZONE("WaitForFrame");
+        m_spoutStereoWindow.WaitForFrame();
+    }
 
     Present();
 }
@@ -425,7 +464,16 @@ void Game::Present()
     // The first argument instructs DXGI to block until VSync, putting the application
     // to sleep until the next VSync. This ensures we don't waste any cycles rendering
     // frames that will never be displayed to the screen.
-    HRESULT hr = m_swapChain->Present(1, 0);
+    // When the main loop is paced by FRAME_PACER_FPS, present immediately instead.
+    UINT syncInterval = m_spoutStereoWindow.framePaced() ? 0 : 1;
+    HRESULT hr;
+    {
+        SPOUT_TRACE_ZONE("Present");
+        hr = m_spoutStereoWindow.Present(m_swapChain.Get(), syncInterval);
+    }
+    if (SUCCEEDED(hr)) {
+        m_spoutStereoWindow.OnPresent();
+    }
 
     // If the device was reset we must completely reinitialize the renderer.
     if (hr == DXGI_ERROR_DEVICE_REMOVED || hr == DXGI_ERROR_DEVICE_RESET) {
@@ -0,0 +1,13 @@
+
+struct VS_Output {
+    float4 pos : SV_POSITION;
+    float3 uv : TEXCOORD;
+};
+
+Texture2DArray mytextures : register(t0);
+SamplerState   mysampler : register(s0);
+
+float4 main(VS_Output input) : SV_Target
+{
+    return mytextures.Sample(mysampler, input.uv);
+}
@@ -0,0 +1,27 @@
+
+// Draws one quad for each tile, into the rectangle of its instance
+
+struct Instance {
+    float4 rect;    // left, top, width and height in normalized device coordinates
+    uint4 slice;    // x is the slice of the texture array
+};
+
+cbuffer Instances : register(b0)
+{
+    Instance instances[256];
+};
+
+struct VS_Output {
+    float4 pos : SV_POSITION;
+    float3 uv : TEXCOORD;
+};
+
+VS_Output main(uint vI : SV_VERTEXID, uint iI : SV_INSTANCEID)
+{
+    VS_Output output;
+    float4 rect = instances[iI].rect;
+    float2 uv = float2(vI & 1, vI >> 1);
+    output.uv = float3(uv, instances[iI].slice.x);
+    output.pos = float4(rect.x + uv.x * rect.z, rect.y - uv.y * rect.w, 0, 1);
+    return output;
+}
@@ -72,6 +72,8 @@
 	07.10.23 - Conditional compile options for _M_ARM64 in CheckSSE and header
 	20.10.23 - FlipBuffer / CopyPixels - default pitch width*4
 	Version 2.007.013
+	19.10.26 - Add rgba2rgbaResample for a band of rows with destination pitch
+			   rgba2rgbaResample - copy a window of the destination for a cropped image
 */
 
 #include "SpoutCopy.h"
@@ -402,6 +404,76 @@ void spoutCopy::rgba2rgbaResample(const void* source, void* dest,
 	}
 }
 
+//---------------------------------------------------------
+// Function: rgba2rgbaResample
+// Copy a band of destination rows of rgba buffers of differing size
+// allowing for destination line pitch, sampling at pixel centres
+//
+//    Destination pixel (x, y) takes source pixel (floor((x + 0.5) * sourceWidth / destWidth),
+//    floor((y + 0.5) * sourceHeight / destHeight)), the same as a point sampled
+//    texture drawn over the destination. Integer arithmetic gives the same result
+//    for every band, so a buffer can be split into bands copied by separate threads.
+//    Rows of equal width are copied with the fastest method if they are aligned.
+//
+//    Only a window of the destination is written, so that an image that extends
+//    past the edges of a buffer is cropped rather than scaled to fit. The window
+//    starts at column destLeft and row destTop and is columns wide. dest is the
+//    address of its first pixel. Rows firstRow to firstRow + rows are counted from
+//    the top of the whole destination and must not start before destTop.
+void spoutCopy::rgba2rgbaResample(const void* source, void* dest,
+	unsigned int sourceWidth, unsigned int sourceHeight, unsigned int sourcePitch,
+	unsigned int destWidth, unsigned int destHeight, unsigned int destPitch,
+	unsigned int destLeft, unsigned int destTop, unsigned int columns,
+	unsigned int firstRow, unsigned int rows, bool bSwapRB) const
+{
+	if (!source || !dest || sourceWidth == 0 || sourceHeight == 0 || destWidth == 0 || destHeight == 0)
+		return;
+
+	if (firstRow < destTop || firstRow >= destHeight || destLeft >= destWidth)
+		return;
+	if (rows > destHeight - firstRow)
+		rows = destHeight - firstRow;
+	if (columns > destWidth - destLeft)
+		columns = destWidth - destLeft;
+
+	const unsigned char* srcBuffer = static_cast<const unsigned char*>(source);
+	unsigned char* dstBuffer = static_cast<unsigned char*>(dest);
+
+	for (unsigned int i = firstRow; i < firstRow + rows; i++) {
+		const unsigned int sy = (unsigned int)(((unsigned __int64)(2 * i + 1) * sourceHeight) / (2ULL * destHeight));
+		const unsigned char* srcRow = srcBuffer + (unsigned __int64)sy * sourcePitch;
+		unsigned char* dstRow = dstBuffer + (unsigned __int64)(i - destTop) * destPitch;
+
+		if (sourceWidth == destWidth) {
+			// The window has the same columns in the source
+			const unsigned char* srcWindow = srcRow + (size_t)destLeft * 4;
+			// The SSE functions need 16 byte aligned rows
+			const bool bAligned = ((uintptr_t)srcWindow % 16) == 0 && ((uintptr_t)dstRow % 16) == 0;
+			if (!bSwapRB) {
+				if (bAligned)
+					CopyPixels(srcWindow, dstRow, columns, 1);
+				else
+					memcpy(dstRow, srcWindow, (size_t)columns * 4);
+				continue;
+			}
+			if (bAligned) {
+				rgba2bgra(srcWindow, dstRow, columns, 1, sourcePitch, destPitch, false);
+				continue;
+			}
+		}
+
+		auto src = reinterpret_cast<const unsigned __int32*>(srcRow);
+		auto dst = reinterpret_cast<unsigned __int32*>(dstRow);
+		for (unsigned int j = 0; j < columns; j++) {
+			const unsigned int sx = (unsigned int)(((unsigned __int64)(2 * (destLeft + j) + 1) * sourceWidth) / (2ULL * destWidth));
+			unsigned __int32 pixel = src[sx];
+			if (bSwapRB)
+				pixel = (pixel & 0xFF00FF00) | ((pixel & 0x00FF0000) >> 16) | ((pixel & 0x000000FF) << 16);
+			dst[j] = pixel;
+		}
+	}
+}
+
 //
 // Group: RGBA <> BGRA
 //
@@ -89,6 +89,15 @@ class SPOUT_DLLEXP spoutCopy {
 			unsigned int sourceWidth, unsigned int sourceHeight, unsigned int sourcePitch,
 			unsigned int destWidth, unsigned int destHeight, bool bInvert = false) const;
 
+		// Copy a band of destination rows of rgba buffers of differing size
+		// allowing for destination line pitch, sampling at pixel centres.
+		// Only the columns from destLeft and rows from destTop are written.
+		void rgba2rgbaResample(const void* source, void* dest,
+			unsigned int sourceWidth, unsigned int sourceHeight, unsigned int sourcePitch,
+			unsigned int destWidth, unsigned int destHeight, unsigned int destPitch,
+			unsigned int destLeft, unsigned int destTop, unsigned int columns,
+			unsigned int firstRow, unsigned int rows, bool bSwapRB = false) const;
+
 		//
 		// RGBA <> BGRA
 		//
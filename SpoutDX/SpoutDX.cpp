@@ -143,6 +143,12 @@
 //		28.10.23	- CheckSender - executable path retrieved in SpoutSenderNames::SetSenderInfo
 //		02.12.23	- Update and test examples with 2.007.013 SpoutGL files. No other changes.
 //		06.12.23	- SetSenderName - use SpoutUtils GetExeName()
+//		19.10.26	- CreateMemoryBuffer - add large page option
+//					  Add GetSenderListGeneration, GetSenderListCacheStats
+//					  Add PresetSenderInfo for receivers resolved in a batch
+//					  CheckSender - renew the sender lease for each frame
+//					  Add GetSenderFrameStats, ResetSenderFrameStats
+//					  Add GetSenderPublishTime
 //
 // ====================================================================================
 /*
@@ -210,6 +216,10 @@ spoutDX::spoutDX()
 	m_bMemoryShare = GetMemoryShareMode(); // 2.006 memoryshare mode
 
 	ZeroMemory(&m_SenderInfo, sizeof(SharedTextureInfo));
+	ZeroMemory(&m_PresetInfo, sizeof(SharedTextureInfo));
+	m_PresetName[0] = 0;
+	m_bPresetInfo = false;
+	m_bPresetFound = false;
 	ZeroMemory(&m_ShExecInfo, sizeof(m_ShExecInfo));
 
 }
@@ -681,6 +691,35 @@ void spoutDX::SetReceiverName(const char * SenderName)
 	}
 }
 
+//---------------------------------------------------------
+// Function: PresetSenderInfo
+// Set sender information for the next receive
+//
+//   A receiver reads the sender shared memory information for every frame.
+//   An application with many receivers can read the information for all
+//   of them in one pass with spoutSenderNames::ResolveSenders and pass
+//   the result to each receiver before ReceiveTexture or ReceiveImage.
+//   The information is used once, and only if the sender name matches.
+//   A null info pointer means that the sender was not found.
+void spoutDX::PresetSenderInfo(const char* sendername, const SharedTextureInfo* info)
+{
+	if (!sendername || !sendername[0]) {
+		m_bPresetInfo = false;
+		return;
+	}
+
+	strcpy_s(m_PresetName, 256, sendername);
+	if (info) {
+		m_PresetInfo = *info;
+		m_bPresetFound = true;
+	}
+	else {
+		ZeroMemory(&m_PresetInfo, sizeof(SharedTextureInfo));
+		m_bPresetFound = false;
+	}
+	m_bPresetInfo = true;
+}
+
 //---------------------------------------------------------
 // Function: ReleaseReceiver
 // Close receiver and release resources ready to connect to another sender
@@ -1118,6 +1157,33 @@ long spoutDX::GetSenderFrame()
 	return frame.GetSenderFrame();
 }
 
+//---------------------------------------------------------
+// Function: GetSenderFrameStats
+// Get sender frame interval statistics
+bool spoutDX::GetSenderFrameStats(SpoutFrameStats& stats)
+{
+	return frame.GetFrameStats(stats);
+}
+
+//---------------------------------------------------------
+// Function: ResetSenderFrameStats
+// Clear sender frame interval statistics
+void spoutDX::ResetSenderFrameStats()
+{
+	frame.ResetFrameStats();
+}
+
+//---------------------------------------------------------
+// Function: GetSenderPublishTime
+// Get the time the sender published the received frame
+//
+//    Microseconds (spoutstats::NowMicroseconds), zero if the
+//    sender does not write the frame channel.
+int64_t spoutDX::GetSenderPublishTime()
+{
+	return frame.GetFramePublishTime();
+}
+
 
 //---------------------------------------------------------
 // COMMON
@@ -1242,6 +1308,26 @@ void spoutDX::SetMaxSenders(int maxSenders)
 	sendernames.SetMaxSenders(maxSenders);
 }
 
+//---------------------------------------------------------
+// Function: GetSenderListGeneration
+// Get sender list generation
+//
+//    Changes when a sender is registered or released.
+//    GetSenderCount and GetSender use a cached list
+//    while the generation is unchanged.
+uint32_t spoutDX::GetSenderListGeneration()
+{
+	return sendernames.GetSenderListGeneration();
+}
+
+//---------------------------------------------------------
+// Function: GetSenderListCacheStats
+// Get sender list cache hits and misses
+void spoutDX::GetSenderListCacheStats(uint64_t &hits, uint64_t &misses)
+{
+	sendernames.GetSenderListCacheStats(hits, misses);
+}
+
 
 //
 // Adapter functions
@@ -1731,7 +1817,9 @@ int spoutDX::ReadMemoryBuffer(const char* name, char* data, int maxlength)
 //    This function should be called before any buffer write
 //    if the length of the data to send will vary.
 //    The map is closed when the sender is released.
-bool spoutDX::CreateMemoryBuffer(const char *name, int length)
+//    Large pages can be requested for large buffers.
+//    Standard pages are used if they are not available.
+bool spoutDX::CreateMemoryBuffer(const char *name, int length, bool bLargePages)
 {
 	// Quit if 2.006 memoryshare mode
 	if (m_bMemoryShare)
@@ -1755,7 +1843,7 @@ bool spoutDX::CreateMemoryBuffer(const char *name, int length)
 	// for data transfer. Make the map 16 bytes larger to compensate. 
 	// Add another 16 bytes to allow for a null terminator.
 	// (Use multiples of 16 for alignment to allow for SSE copy : TODO).
-	if (!memorybuffer.Create(namestring.c_str(), length + 32)) {
+	if (!memorybuffer.Create(namestring.c_str(), length + 32, bLargePages)) {
 		SpoutLogError("spoutGL::CreateMemoryBuffer - could not create shared memory");
 		return false;
 	}
@@ -2066,6 +2154,9 @@ bool spoutDX::CheckSender(unsigned int width, unsigned int height, DWORD dwForma
 
 	} // end size checks
 
+	// Renew the sender lease so that receivers know it is alive
+	sendernames.SenderHeartbeat(m_SenderName);
+
 	return true;
 
 }
@@ -2164,8 +2255,19 @@ bool spoutDX::ReceiveSenderData()
 
 	// Try to get the sender shared memory information.
 	// Retrieve width, height, sharehandle and format.
+	// Use information from PresetSenderInfo if it is for this sender.
 	SharedTextureInfo info={};
-	if (sendernames.getSharedInfo(sendername, &info)) {
+	bool bSenderInfo = false;
+	if (m_bPresetInfo && strcmp(m_PresetName, sendername) == 0) {
+		info = m_PresetInfo;
+		bSenderInfo = m_bPresetFound;
+	}
+	else {
+		bSenderInfo = sendernames.getSharedInfo(sendername, &info);
+	}
+	m_bPresetInfo = false;
+
+	if (bSenderInfo) {
 
 		// Memory share mode not supported (no texture share handle)
 		if (info.shareHandle == 0) {
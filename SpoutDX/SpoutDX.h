@@ -119,6 +119,8 @@ class SPOUT_DLLEXP spoutDX {
 
 	// Set the sender to connect to
 	void SetReceiverName(const char * sendername = nullptr);
+	// Set sender information for the next receive, read by the caller
+	void PresetSenderInfo(const char* sendername, const SharedTextureInfo* info);
 	// Close receiver and free resources
 	void ReleaseReceiver();
 	// Receive from a sender
@@ -155,6 +157,12 @@ class SPOUT_DLLEXP spoutDX {
 	double GetSenderFps();
 	// Received sender frame number
 	long GetSenderFrame();
+	// Received sender frame interval statistics
+	bool GetSenderFrameStats(SpoutFrameStats& stats);
+	// Clear the received frame statistics
+	void ResetSenderFrameStats();
+	// Time the sender published the received frame
+	int64_t GetSenderPublishTime();
 	
 	//
 	// COMMON
@@ -190,6 +198,10 @@ class SPOUT_DLLEXP spoutDX {
 	int  GetMaxSenders();
 	// Set maximum senders allowed
 	void SetMaxSenders(int maxSenders);
+	// Get sender list generation to detect a change
+	uint32_t GetSenderListGeneration();
+	// Get sender list cache hits and misses
+	void GetSenderListCacheStats(uint64_t &hits, uint64_t &misses);
 
 	//
 	// Adapter functions
@@ -281,7 +293,7 @@ class SPOUT_DLLEXP spoutDX {
 	// Read data from shared memory
 	int  ReadMemoryBuffer(const char* name, char* data, int maxlength);
 	// Create a shared memory buffer
-	bool CreateMemoryBuffer(const char *name, int length);
+	bool CreateMemoryBuffer(const char *name, int length, bool bLargePages = false);
 	// Delete a shared memory buffer
 	bool DeleteMemoryBuffer();
 	// Get the number of bytes available for data transfer
@@ -318,6 +330,10 @@ protected :
 	HANDLE m_dxShareHandle;
 	DWORD m_dwFormat;
 	SharedTextureInfo m_SenderInfo;
+	SharedTextureInfo m_PresetInfo; // Sender information from PresetSenderInfo
+	char m_PresetName[256];
+	bool m_bPresetInfo;
+	bool m_bPresetFound;
 	char m_SenderNameSetup[256];
 	char m_SenderName[256];
 	unsigned int m_Width;
@@ -86,6 +86,13 @@
 //					  Change timeout log from error to warning
 //		13.08.23	- EnableFrameCount - correct semaphore name
 //	Version 2.007.013
+//		19.10.26	- Add shared memory frame channel. Receivers read the frame
+//					  count and sender fps with single loads instead of the semaphore.
+//					- HoldFps - use spoutFramePacer for a fixed schedule with
+//					  a calibrated sleep and spin. Remove StartTimePeriod/EndTimePeriod.
+//					- Add GetFrameStats for received frame interval percentiles
+//					  and missed frame counts.
+//					- Add GetFramePublishTime for frame latency measurement
 //
 // ====================================================================================
 //
@@ -131,6 +138,10 @@ spoutFrameCount::spoutFrameCount()
 	m_hSyncEvent = NULL;
 	m_SenderName[0] = 0;
 	m_CountSemaphoreName[0] = 0;
+	m_pFrameChannel = nullptr;
+	m_pFrameStats = new SpoutFrameStats;
+	m_LastFrameTime = 0;
+	m_PublishTime = 0;
 	
 	m_FrameCount = 0L;
 	m_LastFrameCount = 0L;
@@ -139,7 +150,6 @@ spoutFrameCount::spoutFrameCount()
 	m_lastFrame = 0.0;
 	m_SystemFps = GetRefreshRate(); // System refresh rate
 	m_SenderFps = m_SystemFps; // Default sender fps is system refresh rate
-	m_PeriodMin = 0; // For setting Windows time period
 	m_bIsNewFrame = true; // Default true for apps without frame count
 
 	// Check the registry setting for frame counting between sender and receiver
@@ -162,16 +172,11 @@ spoutFrameCount::spoutFrameCount()
 
 #ifdef USE_CHRONO
 
-	// For HoldFps
-	m_FrameStartPtr = new std::chrono::steady_clock::time_point;
-	m_FrameEndPtr = new std::chrono::steady_clock::time_point;
-
 	// Sender fps
 	m_FpsStartPtr = new std::chrono::steady_clock::time_point;
 	m_FpsEndPtr = new std::chrono::steady_clock::time_point;
 
-	// Reset both counts
-	*m_FrameStartPtr = *m_FrameEndPtr = std::chrono::steady_clock::now();
+	// Reset the count
 	*m_FpsStartPtr = *m_FpsEndPtr = std::chrono::steady_clock::now();
 
 #else
@@ -186,8 +191,6 @@ spoutFrameCount::~spoutFrameCount()
 {
 
 #ifdef USE_CHRONO
-	if(m_FrameStartPtr)	delete m_FrameStartPtr;
-	if(m_FrameEndPtr) delete m_FrameEndPtr;
 	if(m_FpsStartPtr) delete m_FpsStartPtr;
 	if(m_FpsEndPtr) delete m_FpsEndPtr;
 #endif
@@ -195,6 +198,7 @@ spoutFrameCount::~spoutFrameCount()
 	if (m_hCountSemaphore) CloseHandle(m_hCountSemaphore);
 	if (m_hAccessMutex) CloseHandle(m_hAccessMutex);
 	if (m_hSyncEvent) CloseHandle(m_hSyncEvent);
+	delete m_pFrameStats;
 
 }
 
@@ -273,12 +277,13 @@ void spoutFrameCount::EnableFrameCount(const char* SenderName)
 	// Reset timers
 #ifdef USE_CHRONO
 	// Reset the counts
-	* m_FrameStartPtr = *m_FrameEndPtr = std::chrono::steady_clock::now();
 	*m_FpsStartPtr = *m_FpsEndPtr = std::chrono::steady_clock::now();
 #else
 	// Initialize PC msec frequency counter
 	StartCounter();
 #endif
+	m_FramePacer.Reset();
+	ResetFrameStats();
 
 	// Return if already enabled for this sender
 	// The sender name can be the same if the adapter has changed
@@ -333,6 +338,10 @@ void spoutFrameCount::EnableFrameCount(const char* SenderName)
 	// Save the handle for access - it could be NULL
 	m_hCountSemaphore = hSemaphore;
 
+	// The frame channel has the same lifetime as the semaphore.
+	// The semaphore is still used with senders that do not write the channel.
+	OpenFrameChannel(SenderName);
+
 }
 
 // -----------------------------------------------
@@ -383,8 +392,16 @@ bool spoutFrameCount::IsFrameNew()
 // -----------------------------------------------
 // Function: GetSenderFps
 // Received frame rate
+//
+// If the sender writes the frame channel, this is the sender's
+// own smoothed frame interval, read without waiting for a frame.
 double spoutFrameCount::GetSenderFps()
 {
+	if (FrameChannelReady()) {
+		const int64_t interval = InterlockedCompareExchange64(&m_pFrameChannel->frameInterval, 0, 0);
+		if (interval > 0)
+			return 1000000.0 / static_cast<double>(interval);
+	}
 	return m_SenderFps;
 }
 
@@ -397,6 +414,51 @@ long spoutFrameCount::GetSenderFrame()
 	return m_FrameCount;
 }
 
+// -----------------------------------------------
+// Function: GetFrameStats
+// Received frame interval statistics
+//
+// Intervals and missed frames since frame counting
+// was enabled for the sender or the statistics were reset.
+// Returns false if no frames have been received.
+bool spoutFrameCount::GetFrameStats(SpoutFrameStats& stats)
+{
+	stats = *m_pFrameStats;
+	return (stats.received > 0);
+}
+
+// -----------------------------------------------
+// Function: ResetFrameStats
+// Clear the received frame statistics
+void spoutFrameCount::ResetFrameStats()
+{
+	m_pFrameStats->received = 0;
+	m_pFrameStats->missed = 0;
+	m_pFrameStats->smoothed = 0.0;
+	m_pFrameStats->interval.Reset();
+	m_LastFrameTime = 0;
+	m_PublishTime = 0;
+}
+
+// -----------------------------------------------
+// Function: GetFramePublishTime
+// Time the sender published the received frame
+//
+// Microseconds from spoutstats::NowMicroseconds, which can be compared
+// between processes. Zero if the sender does not write the frame channel.
+int64_t spoutFrameCount::GetFramePublishTime()
+{
+	return m_PublishTime;
+}
+
+// -----------------------------------------------
+// Function: IsFrameChannel
+// The connected sender is writing the frame channel
+bool spoutFrameCount::IsFrameChannel()
+{
+	return FrameChannelReady();
+}
+
 
 // -----------------------------------------------
 // Function: HoldFps
@@ -406,62 +468,29 @@ long spoutFrameCount::GetSenderFrame()
 // have frame rate control. Must be called every frame.
 // The sender will then signal a new frame at the target rate.
 //
-// Note that this function is affected by changes to Windows timer 
-// resolution since Windows 10 Version 2004 (April 2020)
+// Frames are held to a fixed schedule by spoutFramePacer. Each wait
+// sleeps until shortly before the deadline and spins for the rest,
+// so that the rate is accurate at 120 fps and above and errors from
+// one frame do not accumulate over the following frames.
+//
+// Sleep is affected by changes to Windows timer resolution since
+// Windows 10 Version 2004 (April 2020)
 // https://randomascii.wordpress.com/2020/10/04/windows-timer-resolution-the-great-rule-change/
+// The pacer uses a high resolution waitable timer if available, otherwise
+// the timer period is reduced to the minimum while a frame rate is held.
 //
-// TimeBeginPeriod / TimeEndPeriod avoid loss of precision
-// https://learn.microsoft.com/en-us/windows/win32/api/timeapi/nf-timeapi-timebeginperiod
-// Microsoft remark :
-//   Call this function immediately before using timer services, and call the timeEndPeriod
-//   function immediately after you are finished using the timer services. An application 
-//   can make multiple timeBeginPeriod calls as long as each call is matched with a call
-//   to timeEndPeriod.
-// 
 void spoutFrameCount::HoldFps(int fps)
 {
 	// Unlikely but return anyway
 	if (fps <= 0)
 		return;
 
-	// Reduce Windows timer period to minimum
-	StartTimePeriod();
-
-	// Target frame time
-	const double target = (1000000.0/static_cast<double>(fps))/1000.0; // msec
-
-#ifdef USE_CHRONO
-
-	// Time now end point
-	*m_FrameEndPtr = std::chrono::steady_clock::now();
+	// Restart the schedule if the frame rate has changed
+	if (m_FramePacer.GetFps() != static_cast<double>(fps))
+		m_FramePacer.SetFps(static_cast<double>(fps));
 
-	// Milliseconds elapsed
-	const double elapsedTime = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(*m_FrameEndPtr - *m_FrameStartPtr).count()/1000000.0);
-
-	// Sleep to reach the target frame time
-	if (elapsedTime < target) {
-		std::this_thread::sleep_for(std::chrono::milliseconds(static_cast<long long>(target - elapsedTime)));
-	}
-
-	// Set start time for the next frame
-	*m_FrameStartPtr = std::chrono::steady_clock::now();
-
-#else
-
-	// Milliseconds elapsed
-	double elapsedTime = EndTiming();
-
-	// Sleep to reach the target frame time
-	if (elapsedTime < target)
-		Sleep((DWORD)(target - elapsedTime));
-
-	// Set start time for the next frame
-	StartTiming();
-
-#endif
-
-	// Reset Windows timer period
-	EndTimePeriod();
+	// Wait for the deadline of this frame
+	m_FramePacer.Wait();
 
 }
 
@@ -481,6 +510,11 @@ void spoutFrameCount::SetNewFrame()
 	if (!m_bFrameCount || m_bCountDisabled)
 		return;
 
+	// For receivers using the frame channel.
+	// The semaphore is incremented as well for receivers that do not.
+	if (m_pFrameChannel)
+		UpdateFrameChannel();
+
 	// Access the frame count semaphore
 	// Note: WaitForSingle object will always succeed because
 	// the lock count (sender frame count) is greater than zero,
@@ -537,6 +571,17 @@ bool spoutFrameCount::GetNewFrame()
 	if (!m_bFrameCount || m_bCountDisabled)
 		return true;
 
+	// The sender writes the frame channel.
+	// The frame count is a single load without a kernel call.
+	if (FrameChannelReady()) {
+		framecount = static_cast<long>(InterlockedCompareExchange64(&m_pFrameChannel->frame, 0, 0));
+		m_FrameCount = framecount;
+		UpdateFrameStats(framecount);
+		m_bIsNewFrame = (framecount != m_LastFrameCount);
+		m_LastFrameCount = framecount;
+		return m_bIsNewFrame;
+	}
+
 	// A receiver creates or opens a named semaphore when it connects to a sender
 	// Do not block if semaphore creation failed so that ReceiveTexture can still be called
 	if (!m_hCountSemaphore) {
@@ -578,6 +623,8 @@ bool spoutFrameCount::GetNewFrame()
 	if (framecount == 0)
 		return true;
 
+	UpdateFrameStats(framecount);
+
 	// If this count and the last are the same, the sender has not
 	// produced a new frame and incremented the counter.
 	// Return false if this frame and the last are the same.
@@ -623,6 +670,9 @@ void spoutFrameCount::CleanupFrameCount()
 		// Also closed in sender/receiver release
 		CloseFrameSync();
 
+		// Close the frame channel
+		CloseFrameChannel();
+
 		// Clear the sender name in case the same one opens again
 		m_SenderName[0] = 0;
 
@@ -1016,6 +1066,92 @@ bool spoutFrameCount::AllowKeyedAccess(ID3D11Texture2D* pTexture)
 }
 
 
+// -----------------------------------------------
+// Create or open the frame channel for a sender.
+// Either the sender or a receiver can create it.
+void spoutFrameCount::OpenFrameChannel(const char* SenderName)
+{
+	CloseFrameChannel();
+
+	char name[256] = {};
+	sprintf_s(name, 256, "%s_FrameChannel", SenderName);
+	if (m_frameChannelMap.Create(name, static_cast<int>(sizeof(SpoutFrameChannel))) == SPOUT_CREATE_FAILED) {
+		SpoutLogWarning("    could not create frame channel [%s]", name);
+		return;
+	}
+	m_pFrameChannel = reinterpret_cast<SpoutFrameChannel*>(m_frameChannelMap.Buffer());
+	SpoutLogNotice("    frame channel [%s]", name);
+}
+
+// -----------------------------------------------
+void spoutFrameCount::CloseFrameChannel()
+{
+	m_pFrameChannel = nullptr;
+	m_frameChannelMap.Close();
+}
+
+// -----------------------------------------------
+// Sender write the frame count, time and interval for a new frame.
+// Only the sender writes, so the fields are stored individually
+// and the count is incremented last for receivers.
+void spoutFrameCount::UpdateFrameChannel()
+{
+	SpoutFrameChannel* pChannel = m_pFrameChannel;
+	const int64_t now = static_cast<int64_t>(spoutstats::NowMicroseconds());
+	const int64_t last = pChannel->publishTime;
+	if (last > 0 && now > last) {
+		const int64_t interval = now - last;
+		const int64_t average = pChannel->frameInterval;
+		InterlockedExchange64(&pChannel->frameInterval, (average > 0) ? average + (interval - average) / 16 : interval);
+	}
+	InterlockedExchange64(&pChannel->publishTime, now);
+	InterlockedIncrement64(&pChannel->frame);
+	if (pChannel->magic != SPOUT_FRAME_CHANNEL_MAGIC)
+		InterlockedExchange(reinterpret_cast<volatile LONG*>(&pChannel->magic), SPOUT_FRAME_CHANNEL_MAGIC);
+}
+
+// -----------------------------------------------
+// The sender has written the frame channel
+bool spoutFrameCount::FrameChannelReady()
+{
+	return (m_pFrameChannel && m_pFrameChannel->magic == SPOUT_FRAME_CHANNEL_MAGIC);
+}
+
+// -----------------------------------------------
+// Record the interval since the last new frame received
+// and any frames missed
+void spoutFrameCount::UpdateFrameStats(long framecount)
+{
+	SpoutFrameStats* pStats = m_pFrameStats;
+
+	if (framecount == m_LastFrameCount)
+		return;
+
+	// Time of the frame, from the sender if it writes the frame channel
+	int64_t frametime = 0;
+	if (FrameChannelReady())
+		frametime = InterlockedCompareExchange64(&m_pFrameChannel->publishTime, 0, 0);
+	m_PublishTime = (frametime > 0) ? frametime : 0;
+	if (frametime <= 0)
+		frametime = static_cast<int64_t>(spoutstats::NowMicroseconds());
+
+	pStats->received++;
+
+	// The first frame after the receiver started has no interval
+	if (m_LastFrameCount > 0 && framecount > m_LastFrameCount) {
+		pStats->missed += static_cast<uint64_t>(framecount - m_LastFrameCount - 1);
+		if (m_LastFrameTime > 0 && frametime > m_LastFrameTime) {
+			const double interval = static_cast<double>(frametime - m_LastFrameTime);
+			pStats->interval.Add(static_cast<uint64_t>(interval));
+			if (pStats->smoothed > 0.0)
+				pStats->smoothed += (interval - pStats->smoothed) / 16.0;
+			else
+				pStats->smoothed = interval;
+		}
+	}
+	m_LastFrameTime = frametime;
+}
+
 // -----------------------------------------------
 // Calculate the sender frames per second
 // Applications before 2.007 have a frame rate dependent on the system fps
@@ -1087,33 +1223,6 @@ void spoutFrameCount::UpdateSenderFps(long framecount)
 }
 
 
-// -----------------------------------------------
-// Reduce Windows timing period to the minimum
-// supported by the system (usually 1 msec)
-void spoutFrameCount::StartTimePeriod()
-{
-	TIMECAPS tc={};
-	m_PeriodMin = 0; // To allow for errors
-	MMRESULT mres = timeGetDevCaps(&tc, sizeof(TIMECAPS));
-	if (mres == MMSYSERR_NOERROR) {
-		mres = timeBeginPeriod(tc.wPeriodMin);
-		if (mres == TIMERR_NOERROR)
-			m_PeriodMin = tc.wPeriodMin;
-	}
-}
-
-
-// -----------------------------------------------
-// Reset Windows timing period
-void spoutFrameCount::EndTimePeriod()
-{
-	if (m_PeriodMin > 0) {
-		timeEndPeriod(m_PeriodMin);
-		m_PeriodMin = 0;
-	}
-}
-
-
 // -----------------------------------------------
 //
 // Enable sync event
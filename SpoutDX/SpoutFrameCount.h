@@ -36,6 +36,8 @@
 
 #include "SpoutCommon.h"
 #include "SpoutSharedMemory.h"
+#include "SpoutStats.h"
+#include "SpoutFramePacer.h"
 
 #include <d3d11.h>
 #pragma comment (lib, "d3d11.lib") // for keyed mutex texture access
@@ -50,6 +52,52 @@ using namespace spoututils;
 #include <thread>
 #endif
 
+//
+// Frame channel
+//
+// A small shared memory map "<sendername>_FrameChannel" written by the sender
+// for each frame. A receiver reads the frame count and frame interval with
+// single loads instead of a semaphore wait and release for every frame.
+// The channel is one cache line at the start of the map, which is page aligned.
+//
+// The channel is a separate map rather than part of the sender information map
+// so that a receiver holding it open does not keep the information of a closed
+// sender, which is how receivers detect that a sender has closed.
+//
+#define SPOUT_FRAME_CHANNEL_MAGIC 0x4D415246 // "FRAM"
+
+struct SpoutFrameChannel {		// 64 bytes
+	uint32_t magic;				// SPOUT_FRAME_CHANNEL_MAGIC once the sender has written a frame
+	uint32_t reserved1;
+	int64_t frame;				// Sender frame count
+	int64_t publishTime;		// Time of the last frame in usec (spoutstats::NowMicroseconds)
+	int64_t frameInterval;		// Smoothed interval between frames in usec
+	uint8_t reserved2[32];
+};
+
+static_assert(sizeof(SpoutFrameChannel) == 64, "SpoutFrameChannel must be one cache line");
+
+//
+// Receiver frame statistics
+//
+// Intervals between the frames received from a sender. If the sender writes
+// the frame channel, intervals are measured between the sender's publish times
+// so that they do not include the receiver's own timing. A frame is missed if
+// the sender frame count advanced by more than one since the last receive.
+// Receives without a new frame are not counted, because a receiver can poll
+// many times for each frame that it shows.
+//
+struct SpoutFrameStats {
+
+	SpoutFrameStats() : received(0), missed(0), smoothed(0.0) {}
+
+	uint64_t received; // New frames received
+	uint64_t missed; // Sender frames that were not received
+	double smoothed; // Exponentially weighted moving average of the interval in usec
+	spoutLogHistogram interval; // Microseconds between received frames
+
+};
+
 class SPOUT_DLLEXP spoutFrameCount {
 
 	public:
@@ -77,6 +125,14 @@ class SPOUT_DLLEXP spoutFrameCount {
 	double GetSenderFps();
 	// Received frame count
 	long GetSenderFrame();
+	// Received frame interval statistics
+	bool GetFrameStats(SpoutFrameStats& stats);
+	// Clear the received frame statistics
+	void ResetFrameStats();
+	// Time the sender published the received frame, zero if not known
+	int64_t GetFramePublishTime();
+	// Sender is writing the frame channel
+	bool IsFrameChannel();
 	// Frame rate control
 	void HoldFps(int fps);
 
@@ -160,10 +216,22 @@ protected:
 	double m_SenderFps;
 	void UpdateSenderFps(long framecount = 0);
 
-	// Windows minimum time period
-	UINT m_PeriodMin;
-	void StartTimePeriod();
-	void EndTimePeriod();
+	// Receiver frame statistics
+	SpoutFrameStats* m_pFrameStats; // Pointer to avoid C4251 in SpoutLibrary
+	int64_t m_LastFrameTime; // Time of the last new frame in usec
+	int64_t m_PublishTime; // Sender publish time of the last new frame in usec
+	void UpdateFrameStats(long framecount);
+
+	// Frame channel
+	SpoutSharedMemory m_frameChannelMap;
+	SpoutFrameChannel* m_pFrameChannel;
+	void OpenFrameChannel(const char* SenderName);
+	void CloseFrameChannel();
+	void UpdateFrameChannel();
+	bool FrameChannelReady();
+
+	// Frame rate control
+	spoutFramePacer m_FramePacer;
 
 	// Sync event
 	bool m_bFrameSync;
@@ -178,8 +246,6 @@ protected:
 	// results in warning C4251 needs to have dll-interface
 	std::chrono::steady_clock::time_point* m_FpsStartPtr;
 	std::chrono::steady_clock::time_point* m_FpsEndPtr;
-	std::chrono::steady_clock::time_point* m_FrameStartPtr;
-	std::chrono::steady_clock::time_point* m_FrameEndPtr;
 
 #endif
 
@@ -0,0 +1,280 @@
+/*
+
+	SpoutFramePacer.cpp
+
+	Frame pacing to a fixed schedule
+
+	- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+	19.10.26 - Create class file
+
+*/
+#include "SpoutFramePacer.h"
+
+// Defined in the Windows 10 1803 SDK
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+//
+// Class: spoutFramePacer
+//
+// Absolute deadline frame pacing with a hybrid sleep and spin wait.
+//
+// Refer to source code for documentation.
+//
+
+namespace {
+
+	// Limits of the spin margin in usec
+	const double MinSpinMargin = 50.0;
+	const double MaxSpinFraction = 0.5; // of the frame period
+
+}
+
+spoutFramePacer::spoutFramePacer()
+{
+	m_fps = 0.0;
+	m_period = 0.0;
+	m_start = 0;
+	m_frame = 0;
+	m_PeriodMin = 0;
+	m_pJitter = new spoutLogHistogram;
+	m_missed = 0;
+	m_resyncs = 0;
+
+	m_hTimer = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+
+	// Starting estimates of the oversleep, refined by Calibrate
+	if (m_hTimer) {
+		m_oversleep = 200.0;
+		m_oversleepDeviation = 100.0;
+	}
+	else {
+		m_oversleep = 1000.0;
+		m_oversleepDeviation = 500.0;
+	}
+	m_spinMargin = m_oversleep + 4.0 * m_oversleepDeviation;
+}
+
+spoutFramePacer::~spoutFramePacer()
+{
+	EndTimePeriod();
+	if (m_hTimer) CloseHandle(m_hTimer);
+	delete m_pJitter;
+}
+
+//---------------------------------------------------------
+// Function: SetFps
+// Set the target frame rate and restart the schedule
+//
+//    The timer period is only reduced while a frame rate is set
+//    and the high resolution timer is not available.
+void spoutFramePacer::SetFps(double fps)
+{
+	if (fps > 0.0) {
+		m_fps = fps;
+		m_period = 1000000.0 / fps;
+		if (!m_hTimer)
+			StartTimePeriod();
+	}
+	else {
+		m_fps = 0.0;
+		m_period = 0.0;
+		EndTimePeriod();
+	}
+	Reset();
+}
+
+//---------------------------------------------------------
+// Function: GetFps
+double spoutFramePacer::GetFps()
+{
+	return m_fps;
+}
+
+//---------------------------------------------------------
+// Function: Reset
+// Restart the schedule
+//
+//    The next call to Wait returns immediately and becomes
+//    the start of the schedule.
+void spoutFramePacer::Reset()
+{
+	m_start = 0;
+	m_frame = 0;
+}
+
+//---------------------------------------------------------
+// Function: Wait
+// Wait for the deadline of the next frame
+//
+//    The deadline is computed from the start of the schedule rather
+//    than from the previous frame so that errors do not accumulate.
+//    The thread sleeps until the spin margin before the deadline and
+//    then spins. If the deadline has already passed, the frame is
+//    counted as missed and Wait returns immediately.
+int64_t spoutFramePacer::Wait()
+{
+	if (m_period <= 0.0)
+		return 0;
+
+	uint64_t now = spoutstats::NowMicroseconds();
+
+	// The first frame starts the schedule
+	if (m_start == 0) {
+		m_start = now;
+		m_frame = 0;
+		return 0;
+	}
+
+	m_frame++;
+	const double deadline = static_cast<double>(m_start) + static_cast<double>(m_frame) * m_period;
+
+	if (static_cast<double>(now) < deadline) {
+
+		// Sleep to shortly before the deadline
+		double margin = m_spinMargin;
+		if (margin > m_period * MaxSpinFraction)
+			margin = m_period * MaxSpinFraction;
+		const double wake = deadline - margin;
+		if (static_cast<double>(now) < wake) {
+			CoarseSleep(wake - static_cast<double>(now));
+			now = spoutstats::NowMicroseconds();
+			Calibrate(static_cast<double>(now) - wake);
+		}
+
+		// Spin for the remaining time
+		while (static_cast<double>(now) < deadline) {
+			YieldProcessor();
+			now = spoutstats::NowMicroseconds();
+		}
+	}
+	else {
+		m_missed++;
+	}
+
+	const int64_t deviation = static_cast<int64_t>(static_cast<double>(now) - deadline);
+	m_pJitter->Add(static_cast<uint64_t>(deviation));
+
+	// Restart the schedule rather than catch up with a burst of frames
+	if (static_cast<double>(deviation) > m_period) {
+		m_resyncs++;
+		m_start = now;
+		m_frame = 0;
+	}
+
+	return deviation;
+}
+
+//---------------------------------------------------------
+// Function: GetJitter
+// Copy of the histogram of deviations from the deadline
+bool spoutFramePacer::GetJitter(spoutLogHistogram& jitter)
+{
+	jitter = *m_pJitter;
+	return (jitter.Count() > 0);
+}
+
+//---------------------------------------------------------
+// Function: GetMissed
+// Frames that started after their deadline
+uint64_t spoutFramePacer::GetMissed()
+{
+	return m_missed;
+}
+
+//---------------------------------------------------------
+// Function: GetResyncs
+// Times the schedule was restarted after falling behind
+uint64_t spoutFramePacer::GetResyncs()
+{
+	return m_resyncs;
+}
+
+//---------------------------------------------------------
+// Function: GetSpinMargin
+// Time before the deadline when the sleep ends, in microseconds
+double spoutFramePacer::GetSpinMargin()
+{
+	return m_spinMargin;
+}
+
+//---------------------------------------------------------
+// Function: IsHighResolutionTimer
+bool spoutFramePacer::IsHighResolutionTimer()
+{
+	return (m_hTimer != NULL);
+}
+
+//---------------------------------------------------------
+// Function: ResetStats
+// Clear the deviation histogram and counts
+void spoutFramePacer::ResetStats()
+{
+	m_pJitter->Reset();
+	m_missed = 0;
+	m_resyncs = 0;
+}
+
+//
+// Protected
+//
+
+// Sleep for about the given time, usually a little longer
+void spoutFramePacer::CoarseSleep(double usec)
+{
+	if (m_hTimer) {
+		// Relative due time in 100 nsec units
+		LARGE_INTEGER dueTime = {};
+		dueTime.QuadPart = -static_cast<LONGLONG>(usec * 10.0);
+		if (SetWaitableTimer(m_hTimer, &dueTime, 0, NULL, NULL, FALSE)) {
+			WaitForSingleObject(m_hTimer, INFINITE);
+			return;
+		}
+	}
+	// Whole milliseconds, the spin covers the rest
+	const DWORD dwMsec = static_cast<DWORD>(usec / 1000.0);
+	if (dwMsec > 0)
+		::Sleep(dwMsec);
+}
+
+// Update the spin margin from the time the sleep overran.
+// The margin is the smoothed oversleep plus four times its smoothed
+// deviation, so that the sleep rarely ends after the deadline.
+void spoutFramePacer::Calibrate(double oversleep)
+{
+	if (oversleep < 0.0)
+		oversleep = 0.0;
+	const double error = oversleep - m_oversleep;
+	m_oversleep += error / 8.0;
+	m_oversleepDeviation += ((error < 0.0 ? -error : error) - m_oversleepDeviation) / 4.0;
+
+	double margin = m_oversleep + 4.0 * m_oversleepDeviation;
+	if (margin < MinSpinMargin)
+		margin = MinSpinMargin;
+	if (margin > m_period * MaxSpinFraction)
+		margin = m_period * MaxSpinFraction;
+	m_spinMargin = margin;
+}
+
+// Reduce Windows timing period to the minimum
+// supported by the system (usually 1 msec)
+void spoutFramePacer::StartTimePeriod()
+{
+	if (m_PeriodMin > 0)
+		return;
+	TIMECAPS tc = {};
+	if (timeGetDevCaps(&tc, sizeof(TIMECAPS)) == MMSYSERR_NOERROR) {
+		if (timeBeginPeriod(tc.wPeriodMin) == TIMERR_NOERROR)
+			m_PeriodMin = tc.wPeriodMin;
+	}
+}
+
+// Reset Windows timing period
+void spoutFramePacer::EndTimePeriod()
+{
+	if (m_PeriodMin > 0) {
+		timeEndPeriod(m_PeriodMin);
+		m_PeriodMin = 0;
+	}
+}
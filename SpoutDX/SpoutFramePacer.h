@@ -0,0 +1,92 @@
+/*
+
+	SpoutFramePacer.h
+
+	Frame pacing to a fixed schedule.
+
+	Each frame has an absolute deadline at start + frame * period, so that
+	errors in one wait do not carry over to the next and the frame rate does
+	not drift. The wait is a coarse sleep to shortly before the deadline,
+	followed by a spin for the remaining time. The spin margin is calibrated
+	from the measured oversleep, so that the spin is only as long as the
+	sleep needs on this system.
+
+	A high resolution waitable timer is used for the sleep if the system
+	supports it (Windows 10 1803 and later). Otherwise Sleep is used with
+	the timer period reduced to the minimum while the pacer is active.
+
+	The deviation of each wake from its deadline is recorded in a histogram.
+	If a frame is late by more than one period, the schedule restarts from
+	the current time instead of trying to catch up with a burst of frames.
+
+	Used by spoutFrameCount::HoldFps for senders and by the server main loop.
+
+*/
+#pragma once
+
+#ifndef __spoutFramePacer__
+#define __spoutFramePacer__
+
+#include "SpoutCommon.h"
+#include "SpoutStats.h"
+
+#include <stdint.h>
+
+#pragma comment (lib, "Winmm.lib") // for timer resolution functions
+
+class SPOUT_DLLEXP spoutFramePacer {
+
+public:
+
+	spoutFramePacer();
+	~spoutFramePacer();
+
+	// Set the target frame rate and restart the schedule. Zero to disable.
+	void SetFps(double fps);
+	// Target frame rate, zero if disabled
+	double GetFps();
+	// Restart the schedule from the next call to Wait
+	void Reset();
+
+	// Wait for the deadline of the next frame.
+	// Returns the deviation from the deadline in microseconds, positive if late.
+	int64_t Wait();
+
+	// Copy of the deviation histogram
+	bool GetJitter(spoutLogHistogram& jitter);
+	// Frames that started after their deadline
+	uint64_t GetMissed();
+	// Times the schedule was restarted after falling behind
+	uint64_t GetResyncs();
+	// Current spin margin in microseconds
+	double GetSpinMargin();
+	// A high resolution waitable timer is used for the sleep
+	bool IsHighResolutionTimer();
+	// Clear the recorded statistics
+	void ResetStats();
+
+protected:
+
+	void CoarseSleep(double usec);
+	void Calibrate(double oversleep);
+	void StartTimePeriod();
+	void EndTimePeriod();
+
+	double m_fps;
+	double m_period; // Frame period in usec
+	uint64_t m_start; // Time of the first deadline in usec, zero to restart
+	uint64_t m_frame; // Frames since the start of the schedule
+
+	HANDLE m_hTimer; // High resolution waitable timer
+	UINT m_PeriodMin; // Timer period set for Sleep
+	double m_oversleep; // Smoothed oversleep in usec
+	double m_oversleepDeviation; // Smoothed deviation of the oversleep in usec
+	double m_spinMargin; // Time before the deadline to stop sleeping in usec
+
+	spoutLogHistogram* m_pJitter; // Pointer to avoid C4251 in SpoutLibrary
+	uint64_t m_missed;
+	uint64_t m_resyncs;
+
+};
+
+#endif
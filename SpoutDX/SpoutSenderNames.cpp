@@ -104,6 +104,26 @@
 			   Remove unused d3d9.h and d3d11.h from header
 	16.12.23 - SetSenderInfo - correct buffer size for GetModuleFileNameA
 	Version 2.007.013
+	19.10.26 - Add hashed sender name index (spoutSenderRegistry)
+			   RegisterSenderName, ReleaseSenderName, FindSenderName, cleanSenderSet
+			   edit the sorted name list in place instead of using a set
+			   GetSenderSet, GetSenderCount - cache the sender list until the index generation changes
+			   Add ResolveSenders
+			   Add sender heartbeat and lease. RegisterSenderName checks
+			   the lease of a duplicate name instead of cleaning the whole list.
+			   Add CleanExpiredSenders and background cleanup thread
+			   ResolveSenders - keep senders that were not found until the list changes
+			   Add FindSenderPattern with a prefix and suffix index of the names
+			   CreateSenderSet - limit m_MaxSenders to the size of an existing map
+			   RegisterSenderName - register in the index only when the name list is full
+			   GetSenderSet - include names that are only in the index
+			   ResolveSenders - close the information maps within the pass
+			   RegisterSenderName - remove expired senders when there is no background cleanup
+			   GetSenderSet - always merge the names in the index
+			   SetSenderInfo - copy the texture to the index
+			   ResolveSenders - read the textures from the index and open
+			   only the information maps of other senders, without the index locked
+			   Add WaitForSenderChange
 
 	- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 	Copyright (c) 2014-2024, Lynn Jarvis. All rights reserved.
@@ -145,6 +165,28 @@ spoutSenderNames::spoutSenderNames() {
 
 	m_senders = new std::unordered_map<std::string, SpoutSharedMemory*>();
 
+	m_senderSetCache = new std::set<std::string>();
+	m_bSenderSetCached = false;
+	m_senderSetGeneration = 0;
+	m_senderSetTime = 0;
+	m_dwSenderSetMaxAge = 1000;
+	m_senderSetHits = 0;
+	m_senderSetMisses = 0;
+
+	m_sendersNotFound = new std::unordered_set<std::string>();
+	m_senderInfoGeneration = 0;
+	m_senderInfoTime = 0;
+
+	m_patternNames = new std::vector<std::pair<std::string, uint32_t>>();
+	m_patternSuffixes = new std::vector<std::pair<std::string, uint32_t>>();
+	m_patternGeneration = 0;
+	m_patternTime = 0;
+
+	m_dwSenderLease = 5000;
+	m_dwCleanupInterval = 0;
+	m_hCleanupThread = nullptr;
+	m_hCleanupStop = nullptr;
+
 	// 15.09.18 - moved from interop class
 	// 06.06.19 - increase default maximum number of senders from 10 to 256
 	// 28.08.20 - decreased from 256 to 64
@@ -158,11 +200,19 @@ spoutSenderNames::spoutSenderNames() {
 
 spoutSenderNames::~spoutSenderNames() {
 
+	StopSenderCleanup();
+
 	for (auto itr = m_senders->begin(); itr != m_senders->end(); itr++)
 	{
 		delete itr->second;
 	}
 	delete m_senders;
+	delete m_senderSetCache;
+
+	delete m_sendersNotFound;
+
+	delete m_patternNames;
+	delete m_patternSuffixes;
 
 }
 
@@ -177,8 +227,8 @@ spoutSenderNames::~spoutSenderNames() {
 // Register a new Sender by adding to the list of Sender names
 bool spoutSenderNames::RegisterSenderName(const char* Sendername) {
 
-	std::pair<std::set<std::string>::iterator, bool> ret;
-	std::set<std::string> SenderNames; // set of names
+	if (!Sendername || !Sendername[0] || strlen(Sendername) >= SpoutMaxSenderNameLen)
+		return false;
 
 	// Create the shared memory for the sender name set if it does not exist
 	if (!CreateSenderSet()) {
@@ -189,31 +239,55 @@ bool spoutSenderNames::RegisterSenderName(const char* Sendername) {
 	if (!pBuf) return false;
 
 	// Register the sender name in the list of spout senders
-	readSenderSetFromBuffer(pBuf, SenderNames, m_MaxSenders);
+	int count = getSenderCountFromBuffer(pBuf, m_MaxSenders);
+
+	// Without the background cleanup, dangling entries are removed here.
+	// Only senders whose lease has expired are checked, so this stays cheap.
+	if (!m_hCleanupThread)
+		removeExpiredSenders(pBuf, count);
+
+	// The name can only be used again if the sender has closed.
+	// Names beyond the size of the list are only in the index.
+	const int index = findSenderInBuffer(pBuf, count, Sendername);
+	const bool bIndexed = (index < 0 && m_registry.IsOpen() && m_registry.Find(Sendername) == SPOUT_SLOT_USED);
+	if (index >= 0 || bIndexed) {
+		if (!senderClosed(Sendername)) {
+			m_senderNames.Unlock();
+			return false;
+		}
+		if (index >= 0)
+			removeSenderFromBuffer(pBuf, count, index, m_MaxSenders);
+		if (m_registry.IsOpen())
+			m_registry.Remove(Sendername);
+	}
 
-	// Check whether the sender registration will exceed the maximum number of senders
+	// Check whether the sender registration will exceed the maximum number of senders.
+	// The name is then registered in the index only. It can be found by applications
+	// using the index, but not by those that only read the name list.
 	// If this fails, just skip the registration
-	if ((int)SenderNames.size() == m_MaxSenders) {
-		SpoutLogWarning("spoutSenderNames::RegisterSenderName - Sender exceeds max senders (%d)\n", m_MaxSenders);
+	if (count == m_MaxSenders) {
+		if (m_registry.IsOpen() && m_registry.Insert(Sendername, SPOUT_SLOT_USED)) {
+			m_registry.Heartbeat(Sendername, m_dwSenderLease);
+			SpoutLogNotice("spoutSenderNames::RegisterSenderName - name list is full (%d), [%s] is registered in the index only", m_MaxSenders, Sendername);
+			SetActiveSender(Sendername);
+		}
+		else {
+			SpoutLogWarning("spoutSenderNames::RegisterSenderName - Sender exceeds max senders (%d)\n", m_MaxSenders);
+		}
 		m_senderNames.Unlock();
 		return true;
 	}
 
 	//
-	// Add the Sender name to the set of names
+	// Add the Sender name to the sorted list of names
 	//
-	ret = SenderNames.insert(Sendername);
-
-	if(!ret.second) {
-		// See if there are any dangling entries that aren't valid anymore
-		cleanSenderSet();
-		readSenderSetFromBuffer(pBuf, SenderNames, m_MaxSenders);
-		ret = SenderNames.insert(Sendername);
-	}
-
-	if(ret.second) {
-		// write the new map to shared memory
-		writeBufferFromSenderSet(SenderNames, pBuf, m_MaxSenders);
+	const bool bRegistered = insertSenderInBuffer(pBuf, count, Sendername, m_MaxSenders);
+	if (bRegistered) {
+		// Add to the index and start the lease
+		if (m_registry.IsOpen()) {
+			m_registry.Insert(Sendername, SPOUT_SLOT_USED);
+			m_registry.Heartbeat(Sendername, m_dwSenderLease);
+		}
 		// Set the current sender name as active.
 		// The active sender is the one selected by the user or the last one 
 		// opened by the user, so don't limit to the first sender in the list.
@@ -222,7 +296,7 @@ bool spoutSenderNames::RegisterSenderName(const char* Sendername) {
 	}
 	m_senderNames.Unlock();
 
-	return ret.second;
+	return bRegistered;
 }
 
 //---------------------------------------------------------
@@ -230,8 +304,6 @@ bool spoutSenderNames::RegisterSenderName(const char* Sendername) {
 // Remove a Sender from the set of Sender names
 bool spoutSenderNames::ReleaseSenderName(const char* Sendername) 
 {
-	std::set<std::string> SenderNames;
-	std::string namestring;
 	char name[SpoutMaxSenderNameLen]={};
 
 	if (!Sendername)
@@ -251,27 +323,20 @@ bool spoutSenderNames::ReleaseSenderName(const char* Sendername)
 		m_senders->erase(Sendername);
 	}
 
-	// Read the buffer to a set to iterate through the names
-	readSenderSetFromBuffer(pBuf, SenderNames, m_MaxSenders);
-
-	// Discovered that the project properties had been set to CLI
-	// Properties -> General -> Common Language Runtime Support
-	// and this caused the set "find" function not to work.
-	// It also disabled intellisense.
+	// Names beyond the size of the list are only in the index
+	const bool bIndexed = m_registry.IsOpen() && m_registry.Remove(Sendername);
 
 	// If the sender exists
-	if(SenderNames.find(Sendername) != SenderNames.end() ) {
-		SenderNames.erase(Sendername);
-		// Write the sender names back to the buffer
-		writeBufferFromSenderSet(SenderNames, pBuf, m_MaxSenders);
-		// Is there a set left ?
-		if(SenderNames.size() > 0) {
+	int count = getSenderCountFromBuffer(pBuf, m_MaxSenders);
+	const int index = findSenderInBuffer(pBuf, count, Sendername);
+	if (index >= 0) {
+		removeSenderFromBuffer(pBuf, count, index, m_MaxSenders);
+		// Is there a list left ?
+		if (count > 0) {
 			// Was it the active sender ?
-			if( (getActiveSenderName(&name[0]) && strcmp(&name[0], &Sendername[0]) == 0) || SenderNames.size() == 1) { 
+			if( (getActiveSenderName(&name[0]) && strcmp(&name[0], &Sendername[0]) == 0) || count == 1) { 
 				// It was, so choose the first in the list and make it active instead
-				const std::set<std::string>::iterator iter = SenderNames.begin();
-				namestring = *iter;
-				strcpy_s(name, namestring.c_str());
+				strncpy_s(name, SpoutMaxSenderNameLen, pBuf, _TRUNCATE);
 				// Set it as the active sender
 				setActiveSenderName(&name[0]);
 			}
@@ -282,29 +347,180 @@ bool spoutSenderNames::ReleaseSenderName(const char* Sendername)
 	}
 	m_senderNames.Unlock();
 
-	return false; // Sender name not in the set or no set in shared mempry
+	return bIndexed; // Sender name not in the set or no set in shared mempry
 
 } // end ReleaseSenderName
 
 //---------------------------------------------------------
 // Function: FindSenderName
 // Test to see if a Sender name exists in the sender set
+//
+//    Names registered by this class are found in the hashed index
+//    without reading the name list. Other names are searched for
+//    in the name list and the index is updated for the next search.
 bool spoutSenderNames::FindSenderName(const char* Sendername)
 {
-	if (!Sendername)
+	if (!Sendername || !Sendername[0])
 		return false;
 
-	std::string namestring = "";
-	std::set<std::string> SenderNames;
-	// Get the current list to update the passed list
-	if(GetSenderSet(SenderNames)) {
-		// Does the name exist
-		if (SenderNames.find(Sendername) != SenderNames.end()) {
+	if (!CreateSenderSet())
+		return false;
+
+	uint32_t state = SPOUT_SLOT_EMPTY;
+	bool bExpired = false;
+	if (m_registry.IsOpen()) {
+		state = m_registry.Find(Sendername, &bExpired);
+		if (state == SPOUT_SLOT_USED && !bExpired)
 			return true;
+	}
+
+	// Not indexed, or indexed from the name list and could have been
+	// removed by an application that does not use the index.
+	const char* pBuf = m_senderNames.Lock();
+	if (!pBuf)
+		return false;
+
+	// Names beyond the size of the list are only in the index
+	const int count = getSenderCountFromBuffer(pBuf, m_MaxSenders);
+	bool bFound = (state == SPOUT_SLOT_USED) || (findSenderInBuffer(pBuf, count, Sendername) >= 0);
+	// The sender has stopped. It is removed from the list by
+	// CleanExpiredSenders if it has also closed.
+	if (bFound && bExpired)
+		bFound = hasSharedInfo(Sendername);
+	if (m_registry.IsOpen()) {
+		if (bFound && state == SPOUT_SLOT_EMPTY)
+			m_registry.Insert(Sendername, SPOUT_SLOT_LEGACY);
+		else if (!bFound && state == SPOUT_SLOT_LEGACY)
+			m_registry.Remove(Sendername);
+	}
+
+	m_senderNames.Unlock();
+
+	return bFound;
+}
+
+//---------------------------------------------------------
+// Function: FindSenderPattern
+// Find the first or newest name matching a pattern
+//
+//    The pattern can have one '*' wildcard matching any characters,
+//    for example "LeftWall_*" or "*_RightEye". A pattern without
+//    a wildcard is the same as FindSenderName.
+//
+//    "First" is the first matching name in sorted order.
+//    "Newest" is the matching name most recently registered.
+//
+//    Names with the prefix or suffix are found by binary search
+//    and only those are tested, so the time does not depend on
+//    the total number of senders.
+bool spoutSenderNames::FindSenderPattern(const char* pattern, char* sendername, int maxlength, bool bNewest)
+{
+	if (!pattern || !pattern[0] || !sendername || maxlength <= 0)
+		return false;
+
+	const char* wildcard = strchr(pattern, '*');
+	if (!wildcard) {
+		if (!FindSenderName(pattern))
+			return false;
+		strcpy_s(sendername, maxlength, pattern);
+		return true;
+	}
+
+	if (strchr(wildcard + 1, '*')) {
+		SpoutLogWarning("spoutSenderNames::FindSenderPattern - only one wildcard is supported (%s)", pattern);
+		return false;
+	}
+
+	if (!CreateSenderSet())
+		return false;
+
+	if (!patternIndexValid())
+		buildPatternIndex();
+
+	const std::string prefix(pattern, wildcard - pattern);
+	const std::string suffix(wildcard + 1);
+	const std::string rsuffix(suffix.rbegin(), suffix.rend());
+
+	// Range of names starting with the prefix
+	typedef std::pair<std::string, uint32_t> entry;
+	const auto byKey = [](const entry& e, const std::string& key) { return e.first < key; };
+	const auto startsWith = [](const std::string& s, const std::string& start) {
+		return s.compare(0, start.size(), start) == 0;
+	};
+	auto pfirst = std::lower_bound(m_patternNames->begin(), m_patternNames->end(), prefix, byKey);
+	auto plast = pfirst;
+	while (plast != m_patternNames->end() && startsWith(plast->first, prefix))
+		plast++;
+
+	// Range of reversed names starting with the reversed suffix
+	auto sfirst = std::lower_bound(m_patternSuffixes->begin(), m_patternSuffixes->end(), rsuffix, byKey);
+	auto slast = sfirst;
+	while (slast != m_patternSuffixes->end() && startsWith(slast->first, rsuffix))
+		slast++;
+
+	// Test the smaller range for the other part of the pattern
+	const entry* pMatch = nullptr;
+	const size_t minlength = prefix.size() + suffix.size();
+	const bool bByPrefix = (plast - pfirst) <= (slast - sfirst);
+	const size_t nCandidates = bByPrefix ? (size_t)(plast - pfirst) : (size_t)(slast - sfirst);
+	for (size_t i = 0; i < nCandidates; i++) {
+		const entry& e = bByPrefix ? *(pfirst + i) : (*m_patternNames)[(sfirst + i)->second];
+		const std::string& name = e.first;
+		if (name.size() < minlength)
+			continue;
+		if (!startsWith(name, prefix) || name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0)
+			continue;
+		if (!pMatch
+			|| (bNewest && e.second > pMatch->second)
+			|| (!bNewest && name < pMatch->first))
+			pMatch = &e;
+	}
+
+	if (!pMatch)
+		return false;
+
+	strcpy_s(sendername, maxlength, pMatch->first.c_str());
+	return true;
+
+} // end FindSenderPattern
+
+// The pattern index is valid under the same conditions as the sender list cache
+bool spoutSenderNames::patternIndexValid()
+{
+	const uint32_t generation = m_registry.Generation();
+	if (generation == 0 || generation != m_patternGeneration)
+		return false;
+	return (GetTickCount64() - m_patternTime <= (ULONGLONG)m_dwSenderSetMaxAge);
+}
+
+// Names registered by applications that do not use the hashed index
+// are added to it so that they have a registration sequence.
+void spoutSenderNames::buildPatternIndex()
+{
+	std::set<std::string> names;
+	m_patternNames->clear();
+	m_patternSuffixes->clear();
+	if (!GetSenderSet(names))
+		return;
+
+	const bool bLocked = m_registry.IsOpen() && m_registry.Lock();
+	for (auto itr = names.begin(); itr != names.end(); itr++) {
+		uint32_t sequence = 0;
+		if (bLocked) {
+			sequence = m_registry.Sequence(itr->c_str());
+			if (sequence == 0 && m_registry.Insert(itr->c_str(), SPOUT_SLOT_LEGACY))
+				sequence = m_registry.Sequence(itr->c_str());
 		}
+		// The set is sorted
+		m_patternNames->push_back(std::make_pair(*itr, sequence));
+		m_patternSuffixes->push_back(std::make_pair(std::string(itr->rbegin(), itr->rend()), (uint32_t)(m_patternNames->size() - 1)));
 	}
+	m_patternGeneration = m_registry.Generation();
+	if (bLocked)
+		m_registry.Unlock();
 
-	return false;
+	std::sort(m_patternSuffixes->begin(), m_patternSuffixes->end());
+	m_patternTime = GetTickCount64();
 }
 
 //---------------------------------------------------------
@@ -323,43 +539,55 @@ void spoutSenderNames::cleanSenderSet()
 	    return;
 	}
 
-	std::set<std::string> SenderNames;
-	readSenderSetFromBuffer(pBuf, SenderNames, m_MaxSenders);
-
-	bool changed = false;
-
-	for (auto itr = SenderNames.begin(); itr != SenderNames.end(); )
-	{
+	char name[SpoutMaxSenderNameLen]={};
+	int count = getSenderCountFromBuffer(pBuf, m_MaxSenders);
+	int i = 0;
+	while (i < count) {
+		strncpy_s(name, SpoutMaxSenderNameLen, pBuf + i*SpoutMaxSenderNameLen, _TRUNCATE);
 		// It's one of ours, so thats fine
-		if (m_senders->find(*itr) != m_senders->end())
-		{
-			itr++;
+		if (m_senders->find(name) != m_senders->end()) {
+			i++;
 			continue;
 		}
 		SpoutSharedMemory mem;
-
 		// This isn't found, we clean it up
-		if (!mem.Open((*itr).c_str()))
-		{
-			changed = true;
-			SenderNames.erase(itr++);
+		if (!mem.Open(name)) {
+			removeSenderFromBuffer(pBuf, count, i, m_MaxSenders);
+			if (m_registry.IsOpen())
+				m_registry.Remove(name);
 		}
-		else
-		{
-			++itr;
+		else {
+			i++;
 		}
-		
-	}
-
-	if (changed)
-	{
-		writeBufferFromSenderSet(SenderNames, pBuf, m_MaxSenders);
 	}
 
 	m_senderNames.Unlock();
 	
 }
 
+//---------------------------------------------------------
+// Function: senderClosed
+// Test whether a registered name can be reused
+//
+//    A sender with a current lease is alive without further checks.
+//    Otherwise the sender has closed if its information map has gone.
+//    The caller must hold the lock of the name list.
+bool spoutSenderNames::senderClosed(const char* Sendername)
+{
+	// It's one of ours
+	if (m_senders->find(Sendername) != m_senders->end())
+		return false;
+
+	if (m_registry.IsOpen()) {
+		bool bExpired = false;
+		if (m_registry.Find(Sendername, &bExpired) == SPOUT_SLOT_USED && !bExpired)
+			return false;
+	}
+
+	SpoutSharedMemory mem;
+	return !mem.Open(Sendername);
+}
+
 //---------------------------------------------------------
 // Function: GetSenderNames
 // Return the set of Sender names in shared memory.
@@ -392,6 +620,12 @@ int spoutSenderNames::GetSenderCount() {
 		return 0;
 	}
 
+	// The list has not changed since it was last checked
+	if (senderSetCacheValid()) {
+		m_senderSetHits++;
+		return (int)m_senderSetCache->size();
+	}
+
 	// Doing multiple operations on the sender list, keep it locked
 	if (!m_senderNames.Lock())
 	{
@@ -505,6 +739,207 @@ bool spoutSenderNames::GetSenderNameInfo(int index, char* sendername, int sender
 
 } // end GetSenderNameInfo
 
+//---------------------------------------------------------
+// Function: GetSenderListGeneration
+// Generation of the sender list
+//
+//    Changed whenever a sender is registered or released by an application
+//    using the hashed name index. Compare with a previous value to detect
+//    a change without reading the list. Zero if the index is not available.
+uint32_t spoutSenderNames::GetSenderListGeneration()
+{
+	if (!CreateSenderSet())
+		return 0;
+
+	return m_registry.Generation();
+}
+
+//---------------------------------------------------------
+// Function: WaitForSenderChange
+// Wait for a sender to be registered or released
+//
+//    Returns true when the sender list generation differs from the one given,
+//    or false after the timeout. Applications that do not use the index
+//    do not signal changes, so the timeout is also a retry interval.
+bool spoutSenderNames::WaitForSenderChange(uint32_t generation, DWORD dwTimeout)
+{
+	if (!CreateSenderSet() || !m_registry.IsOpen()) {
+		Sleep(dwTimeout);
+		return false;
+	}
+
+	return m_registry.WaitForChange(generation, dwTimeout);
+}
+
+//---------------------------------------------------------
+// Function: GetSenderListCacheStats
+// Number of times the cached sender list was used or had to be read again
+void spoutSenderNames::GetSenderListCacheStats(uint64_t &hits, uint64_t &misses)
+{
+	hits = m_senderSetHits;
+	misses = m_senderSetMisses;
+}
+
+//---------------------------------------------------------
+// Function: SetSenderListCacheAge
+// Maximum age of the cached sender list (default 1000 msec)
+//
+//    Applications that do not use the hashed name index do not
+//    change the generation. Their changes are seen within this time.
+void spoutSenderNames::SetSenderListCacheAge(DWORD dwMsec)
+{
+	m_dwSenderSetMaxAge = dwMsec;
+}
+
+//---------------------------------------------------------
+// Function: SenderHeartbeat
+// Record a heartbeat for a sender
+//
+//    Called by a sender for each frame to renew the lease.
+//    Usually a single write to the index without locking.
+bool spoutSenderNames::SenderHeartbeat(const char* sendername)
+{
+	if (!sendername || !sendername[0] || !m_registry.IsOpen())
+		return false;
+	return m_registry.Heartbeat(sendername, m_dwSenderLease);
+}
+
+//---------------------------------------------------------
+// Function: SetSenderLease
+// Lease period of senders created by this object
+//
+//    A sender that has not renewed the lease within this time
+//    is tested by receivers and cleaned up if it has closed.
+//    Zero disables the lease. Default 5000 msec.
+void spoutSenderNames::SetSenderLease(DWORD dwMsec)
+{
+	m_dwSenderLease = dwMsec;
+}
+
+//---------------------------------------------------------
+// Function: CleanExpiredSenders
+// Remove senders with expired leases that have closed
+//
+//    Only senders with an expired lease have their information map
+//    opened to check, so the cost does not increase with the number
+//    of senders. A sender that has stopped but not closed is kept.
+//    Returns the number of senders removed.
+int spoutSenderNames::CleanExpiredSenders()
+{
+	if (!CreateSenderSet() || !m_registry.IsOpen())
+		return 0;
+
+	char* pBuf = m_senderNames.Lock();
+	if (!pBuf)
+		return 0;
+
+	int count = getSenderCountFromBuffer(pBuf, m_MaxSenders);
+	const int nRemoved = removeExpiredSenders(pBuf, count);
+
+	m_senderNames.Unlock();
+
+	return nRemoved;
+}
+
+int spoutSenderNames::removeExpiredSenders(char* pBuf, int& count)
+{
+	std::vector<std::string> expired;
+	if (!m_registry.IsOpen() || m_registry.GetExpired(expired) == 0)
+		return 0;
+
+	int nRemoved = 0;
+	for (size_t i = 0; i < expired.size(); i++) {
+		const char* name = expired[i].c_str();
+		// The sender could have renewed the lease since the index was read
+		bool bExpired = false;
+		if (m_registry.Find(name, &bExpired) != SPOUT_SLOT_USED || !bExpired)
+			continue;
+		if (!senderClosed(name))
+			continue;
+		const int index = findSenderInBuffer(pBuf, count, name);
+		if (index >= 0)
+			removeSenderFromBuffer(pBuf, count, index, m_MaxSenders);
+		m_registry.Remove(name);
+		SpoutLogWarning("spoutSenderNames::CleanExpiredSenders - removed closed sender [%s]", name);
+		nRemoved++;
+	}
+
+	return nRemoved;
+}
+
+//---------------------------------------------------------
+// Function: StartSenderCleanup
+// Clean up expired senders in a background thread
+//
+//    Senders with expired leases are checked at the interval given.
+//    Senders without a lease, created by applications that do not use
+//    the index, are checked less often by testing every name in the list.
+bool spoutSenderNames::StartSenderCleanup(DWORD dwIntervalMsec)
+{
+	if (m_hCleanupThread)
+		return true;
+
+	if (dwIntervalMsec == 0)
+		return false;
+
+	m_dwCleanupInterval = dwIntervalMsec;
+	m_hCleanupStop = CreateEventA(NULL, TRUE, FALSE, NULL);
+	if (!m_hCleanupStop) {
+		SpoutLogError("spoutSenderNames::StartSenderCleanup - could not create stop event");
+		return false;
+	}
+
+	m_hCleanupThread = CreateThread(NULL, 0, cleanupThread, (LPVOID)this, 0, NULL);
+	if (!m_hCleanupThread) {
+		SpoutLogError("spoutSenderNames::StartSenderCleanup - could not create thread");
+		CloseHandle(m_hCleanupStop);
+		m_hCleanupStop = nullptr;
+		return false;
+	}
+
+	SpoutLogNotice("spoutSenderNames::StartSenderCleanup - interval %lu msec", dwIntervalMsec);
+
+	return true;
+}
+
+//---------------------------------------------------------
+// Function: StopSenderCleanup
+// Stop the background cleanup
+void spoutSenderNames::StopSenderCleanup()
+{
+	if (m_hCleanupThread) {
+		SetEvent(m_hCleanupStop);
+		WaitForSingleObject(m_hCleanupThread, INFINITE);
+		CloseHandle(m_hCleanupThread);
+		m_hCleanupThread = nullptr;
+	}
+	if (m_hCleanupStop) {
+		CloseHandle(m_hCleanupStop);
+		m_hCleanupStop = nullptr;
+	}
+}
+
+// Background cleanup.
+// Uses a separate object so that the owner's maps
+// are not shared with the owner's thread.
+DWORD WINAPI spoutSenderNames::cleanupThread(LPVOID lpParameter)
+{
+	spoutSenderNames* pOwner = static_cast<spoutSenderNames*>(lpParameter);
+	const DWORD dwInterval = pOwner->m_dwCleanupInterval;
+	const HANDLE hStop = pOwner->m_hCleanupStop;
+
+	spoutSenderNames cleaner;
+	unsigned int nPass = 0;
+	while (WaitForSingleObject(hStop, dwInterval) == WAIT_TIMEOUT) {
+		cleaner.CleanExpiredSenders();
+		// Full check for senders without a lease
+		if (++nPass % 10 == 0)
+			cleaner.cleanSenderSet();
+	}
+
+	return 0;
+}
+
 //---------------------------------------------------------
 // Function: SetMaxSenders
 // Set the maximum number of senders contained in the sender map
@@ -618,6 +1053,12 @@ bool spoutSenderNames::SetSenderInfo(const char* sendername, unsigned int width,
 	__movsd((unsigned long *)pBuf, (unsigned long const *)&info, sizeof(SharedTextureInfo) / 4); // 280 bytes
 
 	senderInfoMap->Unlock();
+
+	// Receivers of many senders read the texture from the index
+	if (m_registry.IsOpen()) {
+		const SpoutRegistryTexture texture = { info.shareHandle, info.width, info.height, info.format };
+		m_registry.SetTexture(sendername, texture);
+	}
 	
 	return true;
 
@@ -1075,6 +1516,88 @@ void spoutSenderNames::writeBufferFromSenderSet(const std::set<std::string>& Sen
 	}
 }
 
+//
+// Functions to edit the list of Sender names in place.
+//
+// The list is sorted in the same order as std::set<std::string>
+// so that it is compatible with readSenderSetFromBuffer and
+// writeBufferFromSenderSet used by other applications.
+//
+
+// Number of names in the list
+int spoutSenderNames::getSenderCountFromBuffer(const char* buffer, int maxSenders)
+{
+	if (!buffer)
+		return 0;
+
+	int count = 0;
+	while (count < maxSenders && buffer[count*SpoutMaxSenderNameLen] != 0)
+		count++;
+
+	return count;
+}
+
+// Binary search for a name.
+// Returns the index of the name or -1 if not found.
+// "position" receives the index where the name would be inserted.
+int spoutSenderNames::findSenderInBuffer(const char* buffer, int count, const char* name, int* position)
+{
+	int low = 0;
+	int high = count;
+	while (low < high) {
+		const int mid = (low + high) / 2;
+		const int cmp = strncmp(buffer + mid*SpoutMaxSenderNameLen, name, SpoutMaxSenderNameLen);
+		if (cmp == 0) {
+			if (position) *position = mid;
+			return mid;
+		}
+		if (cmp < 0)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	if (position) *position = low;
+
+	return -1;
+}
+
+// Insert a name at its sorted position
+bool spoutSenderNames::insertSenderInBuffer(char* buffer, int& count, const char* name, int maxSenders)
+{
+	if (!buffer || count >= maxSenders)
+		return false;
+
+	int position = 0;
+	if (findSenderInBuffer(buffer, count, name, &position) >= 0)
+		return false;
+
+	char* entry = buffer + position*SpoutMaxSenderNameLen;
+	memmove(entry + SpoutMaxSenderNameLen, entry, (size_t)(count - position)*SpoutMaxSenderNameLen);
+	strcpy_s(entry, SpoutMaxSenderNameLen, name);
+	count++;
+
+	// Null terminate the list if it is not full
+	if (count < maxSenders)
+		buffer[count*SpoutMaxSenderNameLen] = '\0';
+
+	return true;
+}
+
+// Remove the name at an index
+void spoutSenderNames::removeSenderFromBuffer(char* buffer, int& count, int index, int maxSenders)
+{
+	if (!buffer || index < 0 || index >= count)
+		return;
+
+	char* entry = buffer + index*SpoutMaxSenderNameLen;
+	memmove(entry, entry + SpoutMaxSenderNameLen, (size_t)(count - index - 1)*SpoutMaxSenderNameLen);
+	count--;
+
+	// Null terminate the list
+	if (count < maxSenders)
+		buffer[count*SpoutMaxSenderNameLen] = '\0';
+}
+
 //
 //  Functions to read and write the list of Sender names to/from shared memory
 //
@@ -1093,6 +1616,31 @@ bool spoutSenderNames::CreateSenderSet()
 		return false;
 	}
 
+	// An existing map can be smaller than m_MaxSenders if it was created
+	// with a different maximum. Limit the list to the size of the map.
+	if (result == SPOUT_ALREADY_EXISTS) {
+		const char* pBuf = m_senderNames.Buffer();
+		MEMORY_BASIC_INFORMATION info{};
+		if (pBuf && VirtualQuery(pBuf, &info, sizeof(info)) > 0) {
+			const int maxSenders = (int)(info.RegionSize / SpoutMaxSenderNameLen);
+			if (maxSenders > 0 && maxSenders < m_MaxSenders) {
+				SpoutLogWarning("spoutSenderNames::CreateSenderSet - sender list is limited to %d senders", maxSenders);
+				m_MaxSenders = maxSenders;
+			}
+		}
+	}
+
+	// Open the hashed index of the names and build it from the
+	// name list if this is the first application to use it.
+	// Without the index, the name list is searched directly.
+	if (!m_registry.IsOpen() && m_registry.Create(m_MaxSenders)) {
+		const char* pBuf = m_senderNames.Lock();
+		if (pBuf) {
+			m_registry.Initialize(pBuf, m_MaxSenders);
+			m_senderNames.Unlock();
+		}
+	}
+
 	return true;
 
 } // end CreateSenderSet
@@ -1106,22 +1654,41 @@ bool spoutSenderNames::GetSenderSet(std::set<std::string>& SenderNames) {
 		return false;
 	}
 
+	// Use the cached list if nothing has changed
+	if (senderSetCacheValid()) {
+		SenderNames = *m_senderSetCache;
+		m_senderSetHits++;
+		return true;
+	}
+
 	pBuf = m_senderNames.Lock();
 	if (!pBuf) {
 		return false;
 	}
+	m_senderSetMisses++;
+
+	// Writers change the generation while holding the name list lock
+	m_senderSetGeneration = m_registry.Generation();
+	m_senderSetTime = GetTickCount64();
 
 	// The data has been stored with 256 bytes reserved for each Sender name
 	// and nothing will have changed with the map yet
-	if(!*pBuf) { // no senders yet
-		m_senderNames.Unlock();
-		return true;
+	SenderNames.clear();
+	if(*pBuf) {
+		// Read back from the mapped memory buffer and rebuild the set that was passed in
+		// The set will then contain the senders currently in the memory map
+		// and allow for any that have been added or deleted
+		readSenderSetFromBuffer(pBuf, SenderNames, m_MaxSenders);
 	}
 
-	// Read back from the mapped memory buffer and rebuild the set that was passed in
-	// The set will then contain the senders currently in the memory map
-	// and allow for any that have been added or deleted
-	readSenderSetFromBuffer(pBuf, SenderNames, m_MaxSenders);
+	// Names registered after the list was full are only in the index
+	if (m_registry.IsOpen()) {
+		std::vector<std::string> indexed;
+		m_registry.GetNames(indexed);
+		SenderNames.insert(indexed.begin(), indexed.end());
+	}
+	*m_senderSetCache = SenderNames;
+	m_bSenderSetCached = true;
 
 	m_senderNames.Unlock();
 
@@ -1129,6 +1696,21 @@ bool spoutSenderNames::GetSenderSet(std::set<std::string>& SenderNames) {
 
 } // end GetSenderSet
 
+// The cached sender list is valid until the index generation changes.
+// Applications that do not use the index do not change the generation,
+// so the list is also read again after a maximum age.
+bool spoutSenderNames::senderSetCacheValid()
+{
+	if (!m_bSenderSetCached)
+		return false;
+
+	const uint32_t generation = m_registry.Generation();
+	if (generation == 0 || generation != m_senderSetGeneration)
+		return false;
+
+	return (GetTickCount64() - m_senderSetTime <= (ULONGLONG)m_dwSenderSetMaxAge);
+}
+
 // Create a shared memory map to set the active Sender name to shared memory
 // This is a separate small shared memory with a fixed sharing name
 // that clients can use to retrieve the current active Sender
@@ -1229,6 +1811,88 @@ bool spoutSenderNames::setSharedInfo(const char* sharedMemoryName, const SharedT
 } // end setSharedInfo
 
 
+//---------------------------------------------------------
+// Function: ResolveSenders
+// Read the information of a list of senders
+//
+//    For receivers of many senders, such as the tiles of a multi-wall display.
+//    Senders that use the index and renew their lease have their share handle,
+//    size and format read from the index in one pass, without opening their
+//    information maps. Only the other senders have their maps opened, after
+//    the index is unlocked. The description and partner ID of a sender read
+//    from the index are zero.
+//
+//    Each information map is closed again within the pass. An open map would
+//    keep a sender that has closed alive for other processes.
+//
+//    Senders that were not found are not looked for again until the sender
+//    list generation changes, or until the maximum age set by
+//    SetSenderListCacheAge for senders that do not use the index.
+//
+//    Returns the number of senders found. "found" is false for senders
+//    without an information map, and the "info" entry is zero.
+int spoutSenderNames::ResolveSenders(const std::vector<std::string> &sendernames, std::vector<SharedTextureInfo> &info, std::vector<bool> &found)
+{
+	info.assign(sendernames.size(), SharedTextureInfo{});
+	found.assign(sendernames.size(), false);
+
+	if (!CreateSenderSet())
+		return 0;
+
+	const uint32_t generation = m_registry.Generation();
+	const ULONGLONG now = GetTickCount64();
+	if (generation == 0 || generation != m_senderInfoGeneration
+		|| now - m_senderInfoTime > (ULONGLONG)m_dwSenderSetMaxAge) {
+		m_sendersNotFound->clear();
+		m_senderInfoGeneration = generation;
+		m_senderInfoTime = now;
+	}
+
+	std::vector<SpoutRegistryTexture> textures;
+	std::vector<bool> indexed;
+	if (m_registry.IsOpen())
+		m_registry.GetTextures(sendernames, textures, indexed);
+	else
+		indexed.assign(sendernames.size(), false);
+
+	int nFound = 0;
+	for (size_t i = 0; i < sendernames.size(); i++) {
+		const std::string& name = sendernames[i];
+		if (name.empty())
+			continue;
+
+		if (indexed[i]) {
+			info[i].shareHandle = textures[i].shareHandle;
+			info[i].width = textures[i].width;
+			info[i].height = textures[i].height;
+			info[i].format = textures[i].format;
+			found[i] = true;
+			nFound++;
+			continue;
+		}
+
+		if (m_sendersNotFound->count(name) > 0)
+			continue;
+
+		SpoutSharedMemory map;
+		if (!map.Open(name.c_str())) {
+			m_sendersNotFound->insert(name);
+			continue;
+		}
+		const char* pBuf = map.Lock();
+		if (pBuf) {
+			__movsd((unsigned long *)&info[i], (unsigned long const *)pBuf, sizeof(SharedTextureInfo) / 4); // 280 bytes
+			map.Unlock();
+			found[i] = true;
+			nFound++;
+		}
+		map.Close();
+	}
+
+	return nFound;
+
+} // end ResolveSenders
+
 // Test for shared info memory map existence
 bool spoutSenderNames::hasSharedInfo(const char* sharedMemoryName)
 {
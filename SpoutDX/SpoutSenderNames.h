@@ -38,6 +38,7 @@
 
 #include "SpoutCommon.h"
 #include "SpoutSharedMemory.h"
+#include "SpoutSenderRegistry.h"
 
 #include <windowsx.h>
 #include <wingdi.h>
@@ -46,6 +47,8 @@
 #include <string>
 #include <vector>
 #include <unordered_map>
+#include <unordered_set>
+#include <algorithm> // for FindSenderPattern
 #include <intrin.h> // for __movsd
 #include <stdint.h> // for _uint32
 #include <assert.h>
@@ -110,6 +113,8 @@ class SPOUT_DLLEXP spoutSenderNames {
 		bool ReleaseSenderName(const char* sendername);
 		// Find a name in the list
 		bool FindSenderName(const char* sendername);
+		// Find the first or newest name matching a pattern with one '*' wildcard
+		bool FindSenderPattern(const char* pattern, char* sendername, int maxlength = SpoutMaxSenderNameLen, bool bNewest = false);
 
 		//
 		// Functions to retrieve info about the sender set map and the senders in it
@@ -124,6 +129,33 @@ class SPOUT_DLLEXP spoutSenderNames {
 		// Information about a sender from an index into the list
 		bool GetSenderNameInfo(int index, char* sendername, int sendernameMaxSize, unsigned int &width, unsigned int &height, HANDLE &dxShareHandle);
 
+		//
+		// Sender list cache
+		//
+
+		// Generation of the sender list, changed when a sender is registered or released
+		uint32_t GetSenderListGeneration();
+		// Number of times the cached sender list was used or had to be read again
+		void GetSenderListCacheStats(uint64_t &hits, uint64_t &misses);
+		// Maximum age of the cached list for changes by applications without the index
+		void SetSenderListCacheAge(DWORD dwMsec);
+		// Wait for a sender to be registered or released
+		bool WaitForSenderChange(uint32_t generation, DWORD dwTimeout);
+
+		//
+		// Sender liveness
+		//
+
+		// Record a heartbeat for a sender, called for each frame
+		bool SenderHeartbeat(const char* sendername);
+		// Lease period of senders created by this object
+		void SetSenderLease(DWORD dwMsec);
+		// Remove senders with expired leases that have closed
+		int  CleanExpiredSenders();
+		// Clean up expired senders in a background thread
+		bool StartSenderCleanup(DWORD dwIntervalMsec);
+		// Stop the background cleanup
+		void StopSenderCleanup();
 
 		//
 		// Maximum number of senders allowed in the list
@@ -151,6 +183,8 @@ class SPOUT_DLLEXP spoutSenderNames {
 		bool setSharedInfo (const char* sendername, const SharedTextureInfo* info);
 		// Test for shared info memory map existence
 		bool hasSharedInfo(const char* sendername);
+		// Read the information of a list of senders, from the index where possible
+		int  ResolveSenders(const std::vector<std::string> &sendernames, std::vector<SharedTextureInfo> &info, std::vector<bool> &found);
 
 		//
 		// Functions to maintain the active sender
@@ -197,12 +231,55 @@ protected:
 		// Goes through the full list of sender names and cleans up
 		// any that shouldn't still be around
 		void cleanSenderSet();
+		// Test whether a registered name can be reused
+		bool senderClosed(const char* sendername);
+		// Remove senders with expired leases that have closed, with the name list locked
+		int  removeExpiredSenders(char* buffer, int& count);
 
 		// Functions to manage shared memory map access
 		static void readSenderSetFromBuffer(const char* buffer, std::set<std::string>& SenderNames, int maxSenders);
 		static void	writeBufferFromSenderSet(const std::set<std::string>& SenderNames, char *buffer, int maxSenders);
 
+		// Functions to edit the sorted name list in place without a set
+		static int  getSenderCountFromBuffer(const char* buffer, int maxSenders);
+		static int  findSenderInBuffer(const char* buffer, int count, const char* name, int* position = nullptr);
+		static bool insertSenderInBuffer(char* buffer, int& count, const char* name, int maxSenders);
+		static void removeSenderFromBuffer(char* buffer, int& count, int index, int maxSenders);
+
 		SpoutSharedMemory m_senderNames;
+		spoutSenderRegistry m_registry; // Hashed index of m_senderNames
+
+		// Sender list cache, valid while the generation is unchanged
+		bool senderSetCacheValid();
+		std::set<std::string>* m_senderSetCache;
+		bool m_bSenderSetCached;
+		uint32_t m_senderSetGeneration;
+		ULONGLONG m_senderSetTime; // msec
+		DWORD m_dwSenderSetMaxAge; // msec
+		uint64_t m_senderSetHits;
+		uint64_t m_senderSetMisses;
+
+		// Senders that ResolveSenders did not find, not looked for again until the list changes
+		std::unordered_set<std::string>* m_sendersNotFound;
+		uint32_t m_senderInfoGeneration;
+		ULONGLONG m_senderInfoTime; // msec
+
+		// Prefix and suffix index of the sender names for FindSenderPattern.
+		// Names with their registration sequence sorted by name, and
+		// reversed names sorted with the position in the name index.
+		bool patternIndexValid();
+		void buildPatternIndex();
+		std::vector<std::pair<std::string, uint32_t>>* m_patternNames;
+		std::vector<std::pair<std::string, uint32_t>>* m_patternSuffixes;
+		uint32_t m_patternGeneration;
+		ULONGLONG m_patternTime; // msec
+
+		// Sender lease and background cleanup
+		static DWORD WINAPI cleanupThread(LPVOID lpParameter);
+		DWORD m_dwSenderLease; // msec
+		DWORD m_dwCleanupInterval; // msec
+		HANDLE m_hCleanupThread;
+		HANDLE m_hCleanupStop;
 		SpoutSharedMemory m_activeSender;
 
 		// This should be a unordered_map of sender names ->SharedMemory
@@ -0,0 +1,882 @@
+/*
+
+	SpoutSenderRegistry.cpp
+
+	Hashed index of sender names in shared memory
+
+	- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+	19.10.26 - Create class file
+			 - Add generation counter
+			 - Add sender heartbeat and lease (version 2)
+			 - Add registration sequence
+			 - Hold the slots in a segment that grows when the table is full (version 3)
+			 - Map a new segment before closing the old one and recover
+			   the names if the segment of the current epoch has closed
+			 - Add the sender texture to the slot (version 4)
+			 - Add WaitForChange with an event for each generation
+
+*/
+#include "SpoutSenderRegistry.h"
+
+//
+// Class: spoutSenderRegistry
+//
+// Open addressing hash table of sender names in shared memory.
+//
+// The header map is linked to a segment holding a power of two number
+// of fixed size slots. Each slot holds the precomputed hash of the name
+// so that a probe compares strings only when the hashes match.
+//
+// Refer to source code for documentation.
+//
+
+spoutSenderRegistry::spoutSenderRegistry()
+{
+	m_segmentEpoch = 0;
+	m_segmentCapacity = 0;
+	m_initialCapacity = 16;
+	m_pSegment = &m_segments[0];
+	m_heartbeatIndex = 0;
+	m_heartbeatHash = 0;
+	m_heartbeatGeneration = 0;
+}
+
+spoutSenderRegistry::~spoutSenderRegistry()
+{
+	Close();
+}
+
+//---------------------------------------------------------
+// Function: Create
+// Create or open the index map
+//
+//    A new index has at least twice as many slots as the number of senders
+//    to keep probe sequences short. It grows when more are registered.
+bool spoutSenderRegistry::Create(int maxSenders)
+{
+	if (m_map.Name())
+		return true;
+
+	m_initialCapacity = 16;
+	while (m_initialCapacity < (uint32_t)maxSenders * 2)
+		m_initialCapacity <<= 1;
+
+	if (m_map.Create("SpoutSenderNamesHash", (int)sizeof(SpoutRegistryHeader)) == SPOUT_CREATE_FAILED) {
+		SpoutLogError("spoutSenderRegistry::Create - could not create index map");
+		return false;
+	}
+
+	return true;
+}
+
+//---------------------------------------------------------
+// Function: Close
+// Close the index map
+void spoutSenderRegistry::Close()
+{
+	m_segments[0].Close();
+	m_segments[1].Close();
+	m_pSegment = &m_segments[0];
+	m_segmentEpoch = 0;
+	m_segmentCapacity = 0;
+	m_map.Close();
+}
+
+//---------------------------------------------------------
+// Function: IsOpen
+// Index map is open
+bool spoutSenderRegistry::IsOpen()
+{
+	return (m_map.Name() != nullptr);
+}
+
+//---------------------------------------------------------
+// Function: Lock
+// Lock the index for a sequence of operations
+//
+//    Lock is recursive for the same object, so the functions
+//    of this class can be used while it is locked.
+bool spoutSenderRegistry::Lock()
+{
+	return (lockIndex() != nullptr);
+}
+
+//---------------------------------------------------------
+// Function: Unlock
+// Unlock the index
+void spoutSenderRegistry::Unlock()
+{
+	m_map.Unlock();
+}
+
+//---------------------------------------------------------
+// Function: Initialize
+// Initialize the index from the legacy name list if it has not been done
+//
+//    The caller must hold the lock of the legacy list.
+bool spoutSenderRegistry::Initialize(const char* legacyBuffer, int maxSenders)
+{
+	char* pBuf = lockIndex();
+	if (!pBuf)
+		return false;
+
+	bool bResult = true;
+	if (!initialized(pBuf))
+		bResult = Rebuild(legacyBuffer, maxSenders);
+
+	m_map.Unlock();
+
+	return bResult;
+}
+
+//---------------------------------------------------------
+// Function: Rebuild
+// Replace the index contents with the legacy name list
+//
+//    All names are marked SPOUT_SLOT_LEGACY.
+//    The index is returned to its initial size in a new segment.
+//    The caller must hold the lock of the legacy list.
+bool spoutSenderRegistry::Rebuild(const char* legacyBuffer, int maxSenders)
+{
+	char* pBuf = lockIndex();
+	if (!pBuf)
+		return false;
+
+	uint32_t capacity = m_initialCapacity;
+	while (capacity < (uint32_t)maxSenders * 2)
+		capacity <<= 1;
+
+	SpoutRegistryHeader* pHeader = header(pBuf);
+	if (!createSegment(pBuf, capacity)) {
+		m_map.Unlock();
+		return false;
+	}
+	pHeader->magic = SPOUT_REGISTRY_MAGIC;
+	pHeader->version = SPOUT_REGISTRY_VERSION;
+	bumpGeneration(pBuf);
+
+	if (legacyBuffer) {
+		const char* name = legacyBuffer;
+		for (int i = 0; i < maxSenders && name[0]; i++) {
+			Insert(name, SPOUT_SLOT_LEGACY);
+			name += SpoutRegistryNameLen;
+		}
+	}
+
+	m_map.Unlock();
+
+	return true;
+}
+
+//---------------------------------------------------------
+// Function: Find
+// Find a name and return the slot state
+//
+//    Returns SPOUT_SLOT_USED or SPOUT_SLOT_LEGACY if found
+//    and SPOUT_SLOT_EMPTY if not.
+//
+//    If pExpired is given, it is set true if the name has a lease
+//    and the last heartbeat is older than the lease period.
+//    Names without a lease, including those indexed from the legacy list,
+//    never expire and have to be checked by opening the sender's information map.
+uint32_t spoutSenderRegistry::Find(const char* name, bool* pExpired)
+{
+	if (pExpired)
+		*pExpired = false;
+
+	if (!name || !name[0])
+		return SPOUT_SLOT_EMPTY;
+
+	char* pBuf = lockIndex();
+	if (!pBuf)
+		return SPOUT_SLOT_EMPTY;
+
+	uint32_t state = SPOUT_SLOT_EMPTY;
+	if (initialized(pBuf)) {
+		const SpoutRegistrySlot* pSlot = findSlot(pBuf, name, Hash(name));
+		if (pSlot) {
+			state = pSlot->state;
+			if (pExpired)
+				*pExpired = expired(pSlot, (int64_t)spoutstats::NowMicroseconds());
+		}
+	}
+
+	m_map.Unlock();
+
+	return state;
+}
+
+//---------------------------------------------------------
+// Function: Insert
+// Insert a name or update the state of an existing name
+//
+//    The index grows if it is full. Fails if a larger segment
+//    cannot be created. The legacy list is still searched for
+//    names that are not in the index.
+bool spoutSenderRegistry::Insert(const char* name, uint32_t state)
+{
+	if (!name || !name[0] || strlen(name) >= SpoutRegistryNameLen)
+		return false;
+
+	char* pBuf = lockIndex();
+	if (!pBuf)
+		return false;
+
+	if (!initialized(pBuf)) {
+		m_map.Unlock();
+		return false;
+	}
+
+	const uint32_t hash = Hash(name);
+	SpoutRegistryHeader* pHeader = header(pBuf);
+	SpoutRegistrySlot* pFree = nullptr;
+	SpoutRegistrySlot* pSlot = findSlot(pBuf, name, hash, &pFree);
+	if (pSlot) {
+		if (pSlot->state != state) {
+			pSlot->state = state;
+			bumpGeneration(pBuf);
+		}
+		m_map.Unlock();
+		return true;
+	}
+
+	// Keep the load factor below 3/4
+	const uint32_t limit = pHeader->capacity - pHeader->capacity / 4;
+	if (pHeader->count + pHeader->deleted + 1 > limit) {
+		if (pHeader->count + 1 > limit) {
+			if (!compact(pBuf, true)) {
+				SpoutLogWarning("spoutSenderRegistry::Insert - index is full (%u)", pHeader->count);
+				m_map.Unlock();
+				return false;
+			}
+		}
+		else {
+			compact(pBuf);
+		}
+		pFree = nullptr;
+		findSlot(pBuf, name, hash, &pFree);
+	}
+
+	if (pFree) {
+		if (pFree->state == SPOUT_SLOT_DELETED)
+			pHeader->deleted--;
+		pFree->hash = hash;
+		pFree->state = state;
+		pFree->lease = 0;
+		pFree->sequence = ++pHeader->sequence;
+		pFree->heartbeat = (int64_t)spoutstats::NowMicroseconds();
+		pFree->texture = SpoutRegistryTexture{};
+		strcpy_s(pFree->name, SpoutRegistryNameLen, name);
+		pHeader->count++;
+		bumpGeneration(pBuf);
+	}
+
+	m_map.Unlock();
+
+	return (pFree != nullptr);
+}
+
+//---------------------------------------------------------
+// Function: Remove
+// Remove a name
+bool spoutSenderRegistry::Remove(const char* name)
+{
+	if (!name || !name[0])
+		return false;
+
+	char* pBuf = lockIndex();
+	if (!pBuf)
+		return false;
+
+	SpoutRegistrySlot* pSlot = nullptr;
+	if (initialized(pBuf)) {
+		pSlot = findSlot(pBuf, name, Hash(name));
+		if (pSlot) {
+			pSlot->state = SPOUT_SLOT_DELETED;
+			pSlot->name[0] = 0;
+			header(pBuf)->count--;
+			header(pBuf)->deleted++;
+			bumpGeneration(pBuf);
+		}
+	}
+
+	m_map.Unlock();
+
+	return (pSlot != nullptr);
+}
+
+//---------------------------------------------------------
+// Function: Count
+// Number of names in the index
+int spoutSenderRegistry::Count()
+{
+	char* pBuf = lockIndex();
+	if (!pBuf)
+		return 0;
+
+	const int count = initialized(pBuf) ? (int)header(pBuf)->count : 0;
+
+	m_map.Unlock();
+
+	return count;
+}
+
+//---------------------------------------------------------
+// Function: Capacity
+// Number of slots in the current segment
+int spoutSenderRegistry::Capacity()
+{
+	char* pBuf = lockIndex();
+	if (!pBuf)
+		return 0;
+
+	const int capacity = initialized(pBuf) ? (int)header(pBuf)->capacity : 0;
+
+	m_map.Unlock();
+
+	return capacity;
+}
+
+//---------------------------------------------------------
+// Function: GetNames
+// Names registered by applications using the index
+//
+//    Names indexed from the legacy list are not included.
+//    Returns the number of names added to the list.
+int spoutSenderRegistry::GetNames(std::vector<std::string>& names)
+{
+	char* pBuf = lockIndex();
+	if (!pBuf)
+		return 0;
+
+	int nNames = 0;
+	if (initialized(pBuf)) {
+		const uint32_t capacity = header(pBuf)->capacity;
+		const SpoutRegistrySlot* pSlots = slots();
+		for (uint32_t i = 0; i < capacity; i++) {
+			if (pSlots[i].state == SPOUT_SLOT_USED) {
+				names.push_back(std::string(pSlots[i].name));
+				nNames++;
+			}
+		}
+	}
+
+	m_map.Unlock();
+
+	return nNames;
+}
+
+//---------------------------------------------------------
+// Function: Sequence
+// Registration sequence of a name
+//
+//    Increases with each name added to the index, so the newest of
+//    several names has the highest sequence. Zero if not found.
+uint32_t spoutSenderRegistry::Sequence(const char* name)
+{
+	if (!name || !name[0])
+		return 0;
+
+	char* pBuf = lockIndex();
+	if (!pBuf)
+		return 0;
+
+	uint32_t sequence = 0;
+	if (initialized(pBuf)) {
+		const SpoutRegistrySlot* pSlot = findSlot(pBuf, name, Hash(name));
+		if (pSlot)
+			sequence = pSlot->sequence;
+	}
+
+	m_map.Unlock();
+
+	return sequence;
+}
+
+//---------------------------------------------------------
+// Function: Generation
+// Generation of the index
+//
+//    Incremented whenever a name is added or removed, so a reader can
+//    keep a copy of the names until the generation changes. Read without
+//    locking. Zero if the index is not available.
+uint32_t spoutSenderRegistry::Generation()
+{
+	char* pBuf = m_map.Buffer();
+	if (!pBuf || header(pBuf)->magic != SPOUT_REGISTRY_MAGIC)
+		return 0;
+
+	return (uint32_t)InterlockedCompareExchange((volatile LONG*)&header(pBuf)->generation, 0, 0);
+}
+
+//---------------------------------------------------------
+// Function: WaitForChange
+// Wait until the generation differs from the one given, or for the timeout
+//
+//    Each generation has its own named manual-reset event, created by the
+//    waiters of that generation and set once by the process that changes it.
+//    No one resets an event, so a change cannot be lost between a waiter
+//    waking and checking the generation. A change before the event was
+//    created is seen by the check after creating it.
+//
+//    Returns true if the generation has changed.
+bool spoutSenderRegistry::WaitForChange(uint32_t generation, DWORD dwTimeout)
+{
+	if (Generation() != generation)
+		return true;
+
+	char name[64] = {};
+	changeEventName(generation, name, 64);
+	HANDLE hEvent = CreateEventA(NULL, TRUE, FALSE, name);
+	if (!hEvent) {
+		Sleep(dwTimeout);
+		return (Generation() != generation);
+	}
+
+	if (Generation() == generation)
+		WaitForSingleObject(hEvent, dwTimeout);
+	CloseHandle(hEvent);
+
+	return (Generation() != generation);
+}
+
+//---------------------------------------------------------
+// Function: Heartbeat
+// Record a heartbeat for a name and set the lease period
+//
+//    Called by a sender for each frame. The slot found by the last call is
+//    written without locking while the generation is unchanged, because
+//    slots only move when names are added or removed or the index grows.
+//    Otherwise the slot is found again with the index locked.
+//
+//    A lease of zero disables expiry of the name.
+bool spoutSenderRegistry::Heartbeat(const char* name, uint32_t leaseMsec)
+{
+	if (!name || !name[0])
+		return false;
+
+	const int64_t now = (int64_t)spoutstats::NowMicroseconds();
+	const uint32_t hash = Hash(name);
+	const uint32_t generation = Generation();
+
+	SpoutRegistrySlot* pSlots = slots();
+	if (pSlots && generation != 0 && generation == m_heartbeatGeneration && hash == m_heartbeatHash
+		&& m_heartbeatIndex < m_segmentCapacity) {
+		// The name is compared as well, another name can have the same hash
+		SpoutRegistrySlot* pSlot = &pSlots[m_heartbeatIndex];
+		if (pSlot->hash == hash && pSlot->state == SPOUT_SLOT_USED
+			&& strncmp(pSlot->name, name, SpoutRegistryNameLen) == 0) {
+			if (pSlot->lease != leaseMsec)
+				InterlockedExchange((volatile LONG*)&pSlot->lease, (LONG)leaseMsec);
+			InterlockedExchange64((volatile LONGLONG*)&pSlot->heartbeat, now);
+			return true;
+		}
+	}
+
+	char* pBuf = lockIndex();
+	if (!pBuf)
+		return false;
+
+	SpoutRegistrySlot* pSlot = nullptr;
+	if (initialized(pBuf)) {
+		pSlot = findSlot(pBuf, name, hash);
+		if (pSlot && pSlot->state == SPOUT_SLOT_USED) {
+			pSlot->lease = leaseMsec;
+			InterlockedExchange64((volatile LONGLONG*)&pSlot->heartbeat, now);
+			m_heartbeatIndex = (uint32_t)(pSlot - slots());
+			m_heartbeatHash = hash;
+			m_heartbeatGeneration = header(pBuf)->generation;
+		}
+		else {
+			pSlot = nullptr;
+		}
+	}
+
+	m_map.Unlock();
+
+	return (pSlot != nullptr);
+}
+
+//---------------------------------------------------------
+// Function: GetExpired
+// Names with expired leases
+//
+//    One pass through the slots, without opening any sender information maps.
+//    Returns the number of names added to the list.
+int spoutSenderRegistry::GetExpired(std::vector<std::string>& names)
+{
+	char* pBuf = lockIndex();
+	if (!pBuf)
+		return 0;
+
+	int nExpired = 0;
+	if (initialized(pBuf)) {
+		const int64_t now = (int64_t)spoutstats::NowMicroseconds();
+		const uint32_t capacity = header(pBuf)->capacity;
+		const SpoutRegistrySlot* pSlots = slots();
+		for (uint32_t i = 0; i < capacity; i++) {
+			if (expired(&pSlots[i], now)) {
+				names.push_back(std::string(pSlots[i].name));
+				nExpired++;
+			}
+		}
+	}
+
+	m_map.Unlock();
+
+	return nExpired;
+}
+
+//---------------------------------------------------------
+// Function: SetTexture
+// Set the texture of a name registered with SPOUT_SLOT_USED
+//
+//    Called by the sender when it creates or updates its information map.
+bool spoutSenderRegistry::SetTexture(const char* name, const SpoutRegistryTexture& texture)
+{
+	if (!name || !name[0])
+		return false;
+
+	char* pBuf = lockIndex();
+	if (!pBuf)
+		return false;
+
+	SpoutRegistrySlot* pSlot = nullptr;
+	if (initialized(pBuf)) {
+		pSlot = findSlot(pBuf, name, Hash(name));
+		if (pSlot && pSlot->state == SPOUT_SLOT_USED)
+			pSlot->texture = texture;
+		else
+			pSlot = nullptr;
+	}
+
+	m_map.Unlock();
+
+	return (pSlot != nullptr);
+}
+
+//---------------------------------------------------------
+// Function: GetTextures
+// Textures of a list of names, read in one pass with the index locked
+//
+//    No sender information maps are opened. "valid" is true for names
+//    registered with SPOUT_SLOT_USED that have set a texture and hold a
+//    lease that has not expired. For other names the texture is zero and
+//    the caller has to open the sender's information map.
+//    Returns the number of valid textures.
+int spoutSenderRegistry::GetTextures(const std::vector<std::string>& names, std::vector<SpoutRegistryTexture>& textures, std::vector<bool>& valid)
+{
+	textures.assign(names.size(), SpoutRegistryTexture{});
+	valid.assign(names.size(), false);
+
+	char* pBuf = lockIndex();
+	if (!pBuf)
+		return 0;
+
+	int nValid = 0;
+	if (initialized(pBuf)) {
+		const int64_t now = (int64_t)spoutstats::NowMicroseconds();
+		for (size_t i = 0; i < names.size(); i++) {
+			if (names[i].empty())
+				continue;
+			const SpoutRegistrySlot* pSlot = findSlot(pBuf, names[i].c_str(), Hash(names[i].c_str()));
+			if (pSlot && pSlot->state == SPOUT_SLOT_USED && pSlot->lease != 0
+				&& pSlot->texture.width != 0 && !expired(pSlot, now)) {
+				textures[i] = pSlot->texture;
+				valid[i] = true;
+				nValid++;
+			}
+		}
+	}
+
+	m_map.Unlock();
+
+	return nValid;
+}
+
+//---------------------------------------------------------
+// Function: Hash
+// FNV-1a hash of a sender name
+uint32_t spoutSenderRegistry::Hash(const char* name)
+{
+	uint32_t hash = 2166136261u;
+	for (const unsigned char* p = (const unsigned char*)name; *p; p++) {
+		hash ^= *p;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+//
+// Protected
+//
+
+SpoutRegistryHeader* spoutSenderRegistry::header(char* pBuf)
+{
+	return reinterpret_cast<SpoutRegistryHeader*>(pBuf);
+}
+
+SpoutRegistrySlot* spoutSenderRegistry::slots()
+{
+	return reinterpret_cast<SpoutRegistrySlot*>(m_pSegment->Buffer());
+}
+
+// The segment that is not in use
+SpoutSharedMemory* spoutSenderRegistry::spareSegment()
+{
+	return (m_pSegment == &m_segments[0]) ? &m_segments[1] : &m_segments[0];
+}
+
+// The segment of the current epoch is mapped
+bool spoutSenderRegistry::initialized(char* pBuf)
+{
+	const SpoutRegistryHeader* pHeader = header(pBuf);
+	return (pHeader->magic == SPOUT_REGISTRY_MAGIC
+		&& pHeader->version == SPOUT_REGISTRY_VERSION
+		&& pHeader->capacity > 0
+		&& pHeader->epoch != 0
+		&& pHeader->epoch == m_segmentEpoch
+		&& pHeader->capacity == m_segmentCapacity);
+}
+
+// Lock the header and map the segment if another process has replaced it.
+// Each process keeps the segment that it has mapped open, so a segment
+// remains after the process that created it exits. If that process exits
+// before any other has mapped the segment, the segment closes with it and
+// the names are recovered from the earlier segment that this process has open.
+char* spoutSenderRegistry::lockIndex()
+{
+	char* pBuf = m_map.Lock();
+	if (!pBuf)
+		return nullptr;
+
+	const SpoutRegistryHeader* pHeader = header(pBuf);
+	if (pHeader->magic == SPOUT_REGISTRY_MAGIC
+		&& pHeader->version == SPOUT_REGISTRY_VERSION
+		&& pHeader->epoch != m_segmentEpoch) {
+		if (!mapSegment(pHeader->epoch, pHeader->capacity) && m_segmentEpoch != 0)
+			recoverSegment(pBuf);
+	}
+
+	return pBuf;
+}
+
+// Open the segment of an epoch.
+// The segment that is mapped is closed only if the new one can be opened.
+bool spoutSenderRegistry::mapSegment(uint32_t epoch, uint32_t capacity)
+{
+	SpoutSharedMemory* pSegment = spareSegment();
+	pSegment->Close();
+
+	char name[64] = {};
+	sprintf_s(name, 64, "SpoutSenderNamesHash_%u", epoch);
+	if (!pSegment->Open(name)) {
+		SpoutLogWarning("spoutSenderRegistry - could not open index segment %s", name);
+		return false;
+	}
+
+	// The view extends to the end of the last page of the section
+	MEMORY_BASIC_INFORMATION info{};
+	VirtualQuery(pSegment->Buffer(), &info, sizeof(info));
+	if (info.RegionSize < (size_t)capacity * sizeof(SpoutRegistrySlot)) {
+		SpoutLogWarning("spoutSenderRegistry - index segment %s is too small", name);
+		pSegment->Close();
+		return false;
+	}
+
+	m_pSegment->Close();
+	m_pSegment = pSegment;
+	m_segmentEpoch = epoch;
+	m_segmentCapacity = capacity;
+
+	return true;
+}
+
+// Replace the segment with a new, empty one and link it from the header.
+// A segment of an earlier epoch can still be open in a process that has not
+// mapped the current one, so each segment has a new epoch. The segment that
+// is mapped is closed only when the new one has been created.
+bool spoutSenderRegistry::createSegment(char* pBuf, uint32_t capacity)
+{
+	const size_t size = (size_t)capacity * sizeof(SpoutRegistrySlot);
+	if (size > (size_t)INT_MAX)
+		return false;
+
+	SpoutSharedMemory* pSegment = spareSegment();
+	pSegment->Close();
+
+	SpoutRegistryHeader* pHeader = header(pBuf);
+	uint32_t epoch = pHeader->epoch;
+	for (int i = 0; i < 16; i++) {
+		// Skip zero, which means that there is no segment
+		if (++epoch == 0)
+			epoch = 1;
+		char name[64] = {};
+		sprintf_s(name, 64, "SpoutSenderNamesHash_%u", epoch);
+		const SpoutCreateResult result = pSegment->Create(name, (int)size);
+		if (result == SPOUT_CREATE_SUCCESS) {
+			m_pSegment->Close();
+			m_pSegment = pSegment;
+			pHeader->epoch = epoch;
+			pHeader->capacity = capacity;
+			m_segmentEpoch = epoch;
+			m_segmentCapacity = capacity;
+			clearSlots(pBuf);
+			return true;
+		}
+		pSegment->Close();
+		if (result == SPOUT_CREATE_FAILED)
+			break;
+	}
+
+	SpoutLogError("spoutSenderRegistry - could not create an index segment of %u slots", capacity);
+	return false;
+}
+
+// Move the names from the segment that is mapped to a new segment
+// of the capacity in the header, when the segment of the current epoch
+// has closed. Names added to the closed segment since this process
+// last mapped one are lost, and are found again in the legacy list.
+bool spoutSenderRegistry::recoverSegment(char* pBuf)
+{
+	SpoutLogWarning("spoutSenderRegistry - index segment %u has closed, recovering names from segment %u",
+		header(pBuf)->epoch, m_segmentEpoch);
+
+	std::vector<SpoutRegistrySlot> used;
+	usedSlots(used);
+
+	uint32_t capacity = header(pBuf)->capacity;
+	while (capacity < (uint32_t)used.size() * 2)
+		capacity <<= 1;
+	if (!createSegment(pBuf, capacity))
+		return false;
+
+	insertSlots(pBuf, used);
+	bumpGeneration(pBuf);
+
+	return true;
+}
+
+// Heartbeat is written without locking
+bool spoutSenderRegistry::expired(const SpoutRegistrySlot* pSlot, int64_t now)
+{
+	if (pSlot->state != SPOUT_SLOT_USED || pSlot->lease == 0)
+		return false;
+	const int64_t heartbeat = InterlockedCompareExchange64((volatile LONGLONG*)&pSlot->heartbeat, 0, 0);
+	return (now - heartbeat > (int64_t)pSlot->lease * 1000);
+}
+
+// Linear probe for a name.
+// Returns the slot holding the name or nullptr.
+// If pFree is given, it receives the first deleted or empty slot
+// in the probe sequence for insertion.
+SpoutRegistrySlot* spoutSenderRegistry::findSlot(char* pBuf, const char* name, uint32_t hash, SpoutRegistrySlot** pFree)
+{
+	const uint32_t capacity = header(pBuf)->capacity;
+	SpoutRegistrySlot* pSlots = slots();
+	if (pFree)
+		*pFree = nullptr;
+
+	uint32_t index = hash & (capacity - 1);
+	for (uint32_t i = 0; i < capacity; i++) {
+		SpoutRegistrySlot* pSlot = &pSlots[index];
+		if (pSlot->state == SPOUT_SLOT_EMPTY) {
+			if (pFree && !*pFree)
+				*pFree = pSlot;
+			return nullptr;
+		}
+		if (pSlot->state == SPOUT_SLOT_DELETED) {
+			if (pFree && !*pFree)
+				*pFree = pSlot;
+		}
+		else if (pSlot->hash == hash && strncmp(pSlot->name, name, SpoutRegistryNameLen) == 0) {
+			return pSlot;
+		}
+		index = (index + 1) & (capacity - 1);
+	}
+
+	return nullptr;
+}
+
+// Skip zero, which means that the generation is not available.
+// Wakes the waiters of the previous generation, if there are any.
+void spoutSenderRegistry::bumpGeneration(char* pBuf)
+{
+	const uint32_t previous = header(pBuf)->generation;
+	if (InterlockedIncrement((volatile LONG*)&header(pBuf)->generation) == 0)
+		InterlockedIncrement((volatile LONG*)&header(pBuf)->generation);
+
+	char name[64] = {};
+	changeEventName(previous, name, 64);
+	HANDLE hEvent = OpenEventA(EVENT_MODIFY_STATE, FALSE, name);
+	if (hEvent) {
+		SetEvent(hEvent);
+		CloseHandle(hEvent);
+	}
+}
+
+// Event set when the generation changes from the one given
+void spoutSenderRegistry::changeEventName(uint32_t generation, char* name, int maxlength)
+{
+	sprintf_s(name, maxlength, "SpoutSenderNamesEvent_%u", generation);
+}
+
+void spoutSenderRegistry::clearSlots(char* pBuf)
+{
+	SpoutRegistryHeader* pHeader = header(pBuf);
+	memset(slots(), 0, (size_t)pHeader->capacity * sizeof(SpoutRegistrySlot));
+	pHeader->count = 0;
+	pHeader->deleted = 0;
+}
+
+// Re-insert all names to remove deleted slots.
+// Only needed after many removals, so a temporary copy is acceptable.
+// If bGrow is true, the names are moved to a new segment of twice the size.
+bool spoutSenderRegistry::compact(char* pBuf, bool bGrow)
+{
+	const uint32_t capacity = header(pBuf)->capacity;
+
+	std::vector<SpoutRegistrySlot> used;
+	usedSlots(used);
+
+	if (bGrow) {
+		// The existing segment remains mapped if this fails
+		if (!createSegment(pBuf, capacity * 2))
+			return false;
+		SpoutLogNotice("spoutSenderRegistry - index increased to %u slots for %u senders", capacity * 2, (uint32_t)used.size());
+	}
+	else {
+		clearSlots(pBuf);
+	}
+
+	insertSlots(pBuf, used);
+
+	// Slots have moved
+	if (bGrow)
+		bumpGeneration(pBuf);
+
+	return true;
+}
+
+// Copy the used and legacy slots of the mapped segment
+void spoutSenderRegistry::usedSlots(std::vector<SpoutRegistrySlot>& used)
+{
+	const SpoutRegistrySlot* pSlots = slots();
+	for (uint32_t i = 0; i < m_segmentCapacity; i++) {
+		if (pSlots[i].state == SPOUT_SLOT_USED || pSlots[i].state == SPOUT_SLOT_LEGACY)
+			used.push_back(pSlots[i]);
+	}
+}
+
+// Insert slots into an empty segment
+void spoutSenderRegistry::insertSlots(char* pBuf, const std::vector<SpoutRegistrySlot>& used)
+{
+	for (size_t i = 0; i < used.size(); i++) {
+		SpoutRegistrySlot* pFree = nullptr;
+		findSlot(pBuf, used[i].name, used[i].hash, &pFree);
+		if (pFree) {
+			*pFree = used[i];
+			header(pBuf)->count++;
+		}
+	}
+}
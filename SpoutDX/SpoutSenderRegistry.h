@@ -0,0 +1,190 @@
+/*
+
+	SpoutSenderRegistry.h
+
+	Hashed index of sender names in shared memory.
+
+	The legacy "SpoutSenderNames" map is a sorted array of 256 byte names
+	that must be read in full to find a sender. This class keeps an
+	open addressing hash table of the same names in a separate map
+	"SpoutSenderNamesHash" so that a name can be found with one or two
+	slot reads and no heap allocation.
+
+	The legacy list remains the authoritative record for compatibility
+	with applications that do not use the index. Names indexed from the
+	legacy list are marked so that they can be verified against it.
+
+	Senders that use the index write a heartbeat time to their slot for
+	each frame. A sender with a lease is alive while the heartbeat is
+	within the lease period, so liveness can be tested with one read
+	instead of opening the sender's information map.
+
+	The share handle, size and format of a sender's texture are also
+	kept in its slot, so a receiver of many senders can read them all
+	with the index locked once instead of opening each information map.
+
+	A receiver waiting for a sender can block until the generation changes
+	on a named event "SpoutSenderNamesEvent_<generation>", which is set by
+	the process that changes that generation.
+
+	The slots are held in a segment "SpoutSenderNamesHash_<epoch>" that is
+	linked from the header. When more than 3/4 of the slots are used, a
+	segment of twice the size is created, the names are moved to it and
+	the epoch in the header is incremented. Other processes map the new
+	segment when they find that the epoch has changed, and keep it open,
+	so it remains after the process that created it exits. If that process
+	exits before any other has mapped the segment, the names are recovered
+	from an earlier segment.
+
+	The index starts at the size of the name list and only grows when more
+	senders are registered, so the number of senders is not limited by the
+	"MaxSenders" registry setting.
+
+	Lock order : "SpoutSenderNames" map first, then "SpoutSenderNamesHash".
+
+*/
+#pragma once
+
+#ifndef __spoutSenderRegistry__
+#define __spoutSenderRegistry__
+
+#include "SpoutCommon.h"
+#include "SpoutSharedMemory.h"
+#include "SpoutStats.h"
+
+#include <stdint.h>
+#include <limits.h> // for INT_MAX
+#include <string>
+#include <vector>
+
+// Same as SpoutMaxSenderNameLen
+#define SpoutRegistryNameLen 256
+
+#define SPOUT_REGISTRY_MAGIC   0x47455253 // "SREG"
+#define SPOUT_REGISTRY_VERSION 4
+
+// Slot states
+#define SPOUT_SLOT_EMPTY   0 // Never used, ends a probe sequence
+#define SPOUT_SLOT_USED    1 // Registered by an application using the index
+#define SPOUT_SLOT_LEGACY  2 // Indexed from the legacy list, verify before use
+#define SPOUT_SLOT_DELETED 3 // Removed, probe sequences continue past it
+
+struct SpoutRegistryHeader {		// 32 bytes
+	uint32_t magic;				// SPOUT_REGISTRY_MAGIC when initialized
+	uint32_t version;			// SPOUT_REGISTRY_VERSION
+	uint32_t capacity;			// Number of slots, a power of two
+	uint32_t count;				// Used and legacy slots
+	uint32_t deleted;			// Deleted slots
+	uint32_t generation;		// Incremented when a name is added or removed
+	uint32_t sequence;			// Registration sequence of the last name added
+	uint32_t epoch;				// Segment holding the slots, incremented when the table grows
+};
+
+// The part of the sender information that a receiver needs
+struct SpoutRegistryTexture {		// 16 bytes
+	uint32_t shareHandle;		// Texture share handle
+	uint32_t width;				// Zero until the sender has set its texture
+	uint32_t height;
+	uint32_t format;
+};
+
+struct SpoutRegistrySlot {			// 296 bytes
+	uint32_t hash;				// FNV-1a hash of the name
+	uint32_t state;				// Slot state
+	uint32_t lease;				// Lease period in msec, zero if the sender has no lease
+	uint32_t sequence;			// Registration sequence, higher is newer
+	int64_t heartbeat;			// Time of the last heartbeat in usec (spoutstats::NowMicroseconds)
+	SpoutRegistryTexture texture; // Written by the sender with the index locked
+	char name[SpoutRegistryNameLen];
+};
+
+class SPOUT_DLLEXP spoutSenderRegistry {
+
+public:
+
+	spoutSenderRegistry();
+	~spoutSenderRegistry();
+
+	// Create or open the index map, initially sized for a number of senders
+	bool Create(int maxSenders);
+	// Close the index map
+	void Close();
+	// Index map is open
+	bool IsOpen();
+
+	// Lock the index for a sequence of operations
+	bool Lock();
+	// Unlock the index
+	void Unlock();
+
+	// Initialize the index from the legacy name list if it has not been done
+	bool Initialize(const char* legacyBuffer, int maxSenders);
+	// Replace the index contents with the legacy name list
+	bool Rebuild(const char* legacyBuffer, int maxSenders);
+
+	// Find a name and return the slot state, SPOUT_SLOT_EMPTY if not found
+	uint32_t Find(const char* name, bool* pExpired = nullptr);
+	// Insert a name or update the state of an existing name
+	bool Insert(const char* name, uint32_t state = SPOUT_SLOT_USED);
+	// Remove a name
+	bool Remove(const char* name);
+	// Number of names in the index
+	int Count();
+	// Number of slots in the current segment
+	int Capacity();
+	// Names registered by applications using the index
+	int GetNames(std::vector<std::string>& names);
+	// Registration sequence of a name, higher is newer. Zero if not found.
+	uint32_t Sequence(const char* name);
+	// Generation of the index, read without locking. Zero if not available.
+	uint32_t Generation();
+	// Wait until the generation differs from the one given, or for the timeout
+	bool WaitForChange(uint32_t generation, DWORD dwTimeout);
+
+	// Record a heartbeat for a name and set the lease period
+	bool Heartbeat(const char* name, uint32_t leaseMsec);
+	// Names with expired leases
+	int GetExpired(std::vector<std::string>& names);
+
+	// Set the texture of a name registered with SPOUT_SLOT_USED
+	bool SetTexture(const char* name, const SpoutRegistryTexture& texture);
+	// Textures of a list of names, read in one pass with the index locked
+	int GetTextures(const std::vector<std::string>& names, std::vector<SpoutRegistryTexture>& textures, std::vector<bool>& valid);
+
+	// FNV-1a hash of a sender name
+	static uint32_t Hash(const char* name);
+
+protected:
+
+	SpoutRegistryHeader* header(char* pBuf);
+	SpoutRegistrySlot* slots();
+	SpoutRegistrySlot* findSlot(char* pBuf, const char* name, uint32_t hash, SpoutRegistrySlot** pFree = nullptr);
+	void clearSlots(char* pBuf);
+	bool compact(char* pBuf, bool bGrow = false);
+	void bumpGeneration(char* pBuf);
+	static void changeEventName(uint32_t generation, char* name, int maxlength);
+	bool initialized(char* pBuf);
+	bool expired(const SpoutRegistrySlot* pSlot, int64_t now);
+	char* lockIndex();
+	bool mapSegment(uint32_t epoch, uint32_t capacity);
+	bool createSegment(char* pBuf, uint32_t capacity);
+	bool recoverSegment(char* pBuf);
+	SpoutSharedMemory* spareSegment();
+	void usedSlots(std::vector<SpoutRegistrySlot>& used);
+	void insertSlots(char* pBuf, const std::vector<SpoutRegistrySlot>& used);
+
+	SpoutSharedMemory m_map; // Header
+	SpoutSharedMemory m_segments[2]; // Slots, the mapped segment and its replacement
+	SpoutSharedMemory* m_pSegment; // Mapped segment
+	uint32_t m_segmentEpoch; // Epoch of the mapped segment
+	uint32_t m_segmentCapacity; // Slots in the mapped segment
+	uint32_t m_initialCapacity; // Slots for a new index
+
+	// Slot of the last heartbeat, valid while the generation is unchanged
+	uint32_t m_heartbeatIndex;
+	uint32_t m_heartbeatHash;
+	uint32_t m_heartbeatGeneration;
+
+};
+
+#endif
@@ -39,6 +39,8 @@
 
 #include <assert.h>
 #include <string>
+#include <map>
+#include <memory>
 
 // ====================================================================================
 //		Revisions :
@@ -52,9 +54,87 @@
 //	Version 2.007.012
 //	07.12.23 - Remove unused <d3d9.h> from header
 //	Version 2.007.013
+//	19.10.26 - Add optional lock statistics (EnableLockStats, GetLockStats, LogLockStats)
+//			   Create - add large page option with fallback to standard pages. Add PageSize()
+//			   Add Buffer() for lock-free access to interlocked fields
 //
 // ====================================================================================
 
+//
+// Process wide lock statistics, keyed by map name.
+// Entries are never removed so that pointers held by open maps stay valid.
+//
+namespace {
+
+	std::atomic<bool> g_bLockStats(false);
+	SRWLOCK g_LockStatsLock = SRWLOCK_INIT;
+
+	std::map<std::string, std::unique_ptr<SpoutLockStats>, std::less<>>& LockStatsMap()
+	{
+		static std::map<std::string, std::unique_ptr<SpoutLockStats>, std::less<>> statsmap;
+		return statsmap;
+	}
+
+	SpoutLockStats* FindOrCreateLockStats(const char* name)
+	{
+		if (!name)
+			return nullptr;
+
+		auto& statsmap = LockStatsMap();
+
+		AcquireSRWLockShared(&g_LockStatsLock);
+		auto found = statsmap.find(name);
+		SpoutLockStats* pStats = (found != statsmap.end()) ? found->second.get() : nullptr;
+		ReleaseSRWLockShared(&g_LockStatsLock);
+		if (pStats)
+			return pStats;
+
+		AcquireSRWLockExclusive(&g_LockStatsLock);
+		std::unique_ptr<SpoutLockStats>& entry = statsmap[name];
+		if (!entry)
+			entry.reset(new SpoutLockStats());
+		pStats = entry.get();
+		ReleaseSRWLockExclusive(&g_LockStatsLock);
+
+		return pStats;
+	}
+
+	// Large page mapping requires the "Lock pages in memory" privilege
+	// to be granted to the user account. Enable it for this process.
+	bool EnableLockMemoryPrivilege()
+	{
+		HANDLE hToken = NULL;
+		if (!OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &hToken))
+			return false;
+
+		TOKEN_PRIVILEGES tp{};
+		tp.PrivilegeCount = 1;
+		tp.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+		bool bEnabled = false;
+		if (LookupPrivilegeValueA(NULL, "SeLockMemoryPrivilege", &tp.Privileges[0].Luid)) {
+			// AdjustTokenPrivileges succeeds even if the privilege is not held
+			if (AdjustTokenPrivileges(hToken, FALSE, &tp, 0, NULL, NULL))
+				bEnabled = (GetLastError() == ERROR_SUCCESS);
+		}
+		CloseHandle(hToken);
+		SetLastError(NO_ERROR);
+
+		return bEnabled;
+	}
+
+	size_t StandardPageSize()
+	{
+		SYSTEM_INFO info{};
+		GetSystemInfo(&info);
+		return (size_t)info.dwPageSize;
+	}
+
+}
+
+// Windows 10 1703 and later. Earlier versions map large page sections with large pages.
+#ifndef FILE_MAP_LARGE_PAGES
+#define FILE_MAP_LARGE_PAGES 0x20000000
+#endif
 
 //
 // Class: SpoutSharedMemory
@@ -70,7 +150,10 @@ SpoutSharedMemory::SpoutSharedMemory()
 	m_hMap = NULL;
 	m_pName = NULL;
 	m_size = 0;
+	m_pageSize = 0;
 	m_lockCount = 0;
+	m_pLockStats = NULL;
+	m_lockStart = 0;
 }
 
 SpoutSharedMemory::~SpoutSharedMemory()
@@ -86,7 +169,13 @@ SpoutSharedMemory::~SpoutSharedMemory()
 //---------------------------------------------------------
 // Function: Create
 // Create a new memory segment, or attach to an existing one
-SpoutCreateResult SpoutSharedMemory::Create(const char* name, int size)
+//
+//    Large pages reduce TLB misses for large frame buffers.
+//    They require the "Lock pages in memory" user right,
+//    and the map size is rounded up to the large page size.
+//    If large pages are not available, standard pages are used.
+//    Use PageSize() to find the page size granted.
+SpoutCreateResult SpoutSharedMemory::Create(const char* name, int size, bool bLargePages)
 {
 	DWORD err = 0;
 
@@ -107,12 +196,42 @@ SpoutCreateResult SpoutSharedMemory::Create(const char* name, int size)
 	// In this scenario, CreateFileMapping creates a file mapping object of a specified size
 	// that is backed by the system paging file instead of by a file in the file system.
 
-	m_hMap = CreateFileMappingA ( INVALID_HANDLE_VALUE,
-									NULL,
-									PAGE_READWRITE,
-									0,
-									(DWORD)size,
-									(LPCSTR)name);
+	size_t largePageSize = 0;
+	if (bLargePages) {
+		largePageSize = GetLargePageMinimum();
+		if (largePageSize == 0) {
+			SpoutLogWarning("SpoutSharedMemory::Create - large pages are not supported");
+		}
+		else if (!EnableLockMemoryPrivilege()) {
+			SpoutLogWarning("SpoutSharedMemory::Create - large pages need the \"Lock pages in memory\" privilege");
+			largePageSize = 0;
+		}
+	}
+
+	if (largePageSize > 0) {
+		// Large page sections must be committed and a multiple of the large page size
+		const size_t mapsize = ((size_t)size + largePageSize - 1) / largePageSize * largePageSize;
+		m_hMap = CreateFileMappingA ( INVALID_HANDLE_VALUE,
+										NULL,
+										PAGE_READWRITE | SEC_COMMIT | SEC_LARGE_PAGES,
+										(DWORD)((uint64_t)mapsize >> 32),
+										(DWORD)(mapsize & 0xFFFFFFFF),
+										(LPCSTR)name);
+		if (m_hMap == NULL) {
+			err = GetLastError();
+			SpoutLogWarning("SpoutSharedMemory::Create - large page map failed error = %lu (0x%4.4lX)", err, err);
+			largePageSize = 0;
+		}
+	}
+
+	if (m_hMap == NULL) {
+		m_hMap = CreateFileMappingA ( INVALID_HANDLE_VALUE,
+										NULL,
+										PAGE_READWRITE,
+										0,
+										(DWORD)size,
+										(LPCSTR)name);
+	}
 
 	if (m_hMap == NULL)	{
 		err = GetLastError();
@@ -127,6 +246,8 @@ SpoutCreateResult SpoutSharedMemory::Create(const char* name, int size)
 	bool alreadyExists = false;
 	if (err == ERROR_ALREADY_EXISTS) {
 		alreadyExists = true;
+		// The existing section keeps the page type it was created with
+		largePageSize = 0;
 		// Clear the error to avoid detection elsewhere.
 		SetLastError(NO_ERROR);
 		// The size of the map will be the same as when it was created.
@@ -141,7 +262,16 @@ SpoutCreateResult SpoutSharedMemory::Create(const char* name, int size)
 	// We can depend on the mapping object to be initially zeros.
 	// https://docs.microsoft.com/en-us/windows/win32/api/winbase/nf-winbase-createfilemappinga
 
-	m_pBuffer = (char*)MapViewOfFile(m_hMap, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+	if (largePageSize > 0) {
+		m_pBuffer = (char*)MapViewOfFile(m_hMap, FILE_MAP_ALL_ACCESS | FILE_MAP_LARGE_PAGES, 0, 0, 0);
+		if (!m_pBuffer) {
+			// Earlier than Windows 10 1703
+			m_pBuffer = (char*)MapViewOfFile(m_hMap, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+		}
+	}
+	else {
+		m_pBuffer = (char*)MapViewOfFile(m_hMap, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+	}
 
 	if (!m_pBuffer)	{
 		Close();
@@ -164,6 +294,12 @@ SpoutCreateResult SpoutSharedMemory::Create(const char* name, int size)
 
 	m_size = size;
 
+	m_pageSize = (largePageSize > 0) ? largePageSize : StandardPageSize();
+	if (bLargePages) {
+		SpoutLogNotice("SpoutSharedMemory::Create - [%s] %d bytes, %s pages (%zu bytes)",
+			name, size, (largePageSize > 0) ? "large" : "standard", m_pageSize);
+	}
+
 	return alreadyExists ? SPOUT_ALREADY_EXISTS : SPOUT_CREATE_SUCCESS;
 
 }
@@ -214,6 +350,9 @@ bool SpoutSharedMemory::Open(const char* name)
 	// Only the process that creates the shared memory can save it's size.
 	m_size = 0;
 
+	// Standard page view. A receiver does not know the page type of the section.
+	m_pageSize = StandardPageSize();
+
 	return true;
 
 }
@@ -244,6 +383,9 @@ void SpoutSharedMemory::Close()
 	}
 
 	m_size = 0;
+	m_pageSize = 0;
+	m_pLockStats = NULL;
+	m_lockStart = 0;
 
 }
 
@@ -273,7 +415,28 @@ char* SpoutSharedMemory::Lock()
 		return m_pBuffer;
 	}
 
+	// Statistics are resolved once for each object while enabled
+	// and cost two counter reads per acquisition.
+	if (g_bLockStats.load(std::memory_order_relaxed) && !m_pLockStats) {
+		m_pLockStats = FindOrCreateLockStats(m_pName);
+	}
+	const bool bStats = m_pLockStats && g_bLockStats.load(std::memory_order_relaxed);
+	const uint64_t waitStart = bStats ? spoutstats::NowMicroseconds() : 0;
+
 	const DWORD waitResult = WaitForSingleObject(m_hMutex, 67);
+
+	if (bStats) {
+		const uint64_t now = spoutstats::NowMicroseconds();
+		m_pLockStats->wait.Add(now - waitStart);
+		if (waitResult != WAIT_OBJECT_0) {
+			m_pLockStats->timeouts++;
+		}
+		else {
+			m_pLockStats->acquisitions++;
+			m_lockStart = now;
+		}
+	}
+
 	if (waitResult != WAIT_OBJECT_0) {
 		return nullptr;
 	}
@@ -295,6 +458,11 @@ void SpoutSharedMemory::Unlock()
 	assert(m_lockCount >= 0);
 
 	if (m_lockCount == 0) {
+		if (m_lockStart > 0) {
+			if (m_pLockStats)
+				m_pLockStats->hold.Add(spoutstats::NowMicroseconds() - m_lockStart);
+			m_lockStart = 0;
+		}
 		ReleaseMutex(m_hMutex);
 	}
 }
@@ -307,6 +475,17 @@ const char* SpoutSharedMemory::Name()
 	return m_pName;
 }
 
+//---------------------------------------------------------
+// Function: Buffer
+// Return the buffer of an open map without locking
+//
+//    Only for fields that are read and written with
+//    interlocked functions. Use Lock for all other access.
+char* SpoutSharedMemory::Buffer()
+{
+	return m_pBuffer;
+}
+
 //---------------------------------------------------------
 // Function: Size
 // Return the size of an existing map
@@ -315,6 +494,16 @@ int SpoutSharedMemory::Size()
 	return m_size;
 }
 
+//---------------------------------------------------------
+// Function: PageSize
+// Return the page size of an existing map
+//
+//    The large page size if granted by Create, otherwise the standard page size.
+size_t SpoutSharedMemory::PageSize()
+{
+	return m_pageSize;
+}
+
 //---------------------------------------------------------
 // Function: Debug
 // Print map information for debugging
@@ -328,3 +517,99 @@ void SpoutSharedMemory::Debug()
 	}
 
 }
+
+//
+// Group: Lock instrumentation
+//
+// Records mutex wait time, hold time, acquisitions and timeouts
+// for each named map. Disabled by default. When enabled, each
+// acquisition adds two performance counter reads and a few
+// relaxed atomic increments.
+//
+
+//---------------------------------------------------------
+// Function: EnableLockStats
+// Enable or disable lock statistics for all maps in this process
+void SpoutSharedMemory::EnableLockStats(bool bEnable)
+{
+	g_bLockStats.store(bEnable);
+}
+
+//---------------------------------------------------------
+// Function: IsLockStatsEnabled
+// Lock statistics status
+bool SpoutSharedMemory::IsLockStatsEnabled()
+{
+	return g_bLockStats.load();
+}
+
+//---------------------------------------------------------
+// Function: GetLockStats
+// Copy the statistics recorded for a map name
+bool SpoutSharedMemory::GetLockStats(const char* name, SpoutLockStats& stats)
+{
+	if (!name)
+		return false;
+
+	bool bFound = false;
+	AcquireSRWLockShared(&g_LockStatsLock);
+	auto found = LockStatsMap().find(name);
+	if (found != LockStatsMap().end()) {
+		stats = *found->second;
+		bFound = true;
+	}
+	ReleaseSRWLockShared(&g_LockStatsLock);
+
+	return bFound;
+}
+
+//---------------------------------------------------------
+// Function: GetLockStatsNames
+// Names of all maps with recorded statistics
+void SpoutSharedMemory::GetLockStatsNames(std::vector<std::string>& names)
+{
+	names.clear();
+	AcquireSRWLockShared(&g_LockStatsLock);
+	for (auto itr = LockStatsMap().begin(); itr != LockStatsMap().end(); itr++) {
+		names.push_back(itr->first);
+	}
+	ReleaseSRWLockShared(&g_LockStatsLock);
+}
+
+//---------------------------------------------------------
+// Function: LogLockStats
+// Write the statistics for all maps to the Spout log
+void SpoutSharedMemory::LogLockStats(bool bReset)
+{
+	AcquireSRWLockShared(&g_LockStatsLock);
+	for (auto itr = LockStatsMap().begin(); itr != LockStatsMap().end(); itr++) {
+		SpoutLockStats* pStats = itr->second.get();
+		SpoutLogNotice("SpoutSharedMemory lock [%s] : acquisitions %llu, timeouts %llu",
+			itr->first.c_str(), pStats->acquisitions.load(), pStats->timeouts.load());
+		SpoutLogNotice("    wait : %s", pStats->wait.Summary().c_str());
+		SpoutLogNotice("    hold : %s", pStats->hold.Summary().c_str());
+		if (bReset) {
+			pStats->acquisitions = 0;
+			pStats->timeouts = 0;
+			pStats->wait.Reset();
+			pStats->hold.Reset();
+		}
+	}
+	ReleaseSRWLockShared(&g_LockStatsLock);
+}
+
+//---------------------------------------------------------
+// Function: ResetLockStats
+// Clear all recorded statistics
+void SpoutSharedMemory::ResetLockStats()
+{
+	AcquireSRWLockShared(&g_LockStatsLock);
+	for (auto itr = LockStatsMap().begin(); itr != LockStatsMap().end(); itr++) {
+		SpoutLockStats* pStats = itr->second.get();
+		pStats->acquisitions = 0;
+		pStats->timeouts = 0;
+		pStats->wait.Reset();
+		pStats->hold.Reset();
+	}
+	ReleaseSRWLockShared(&g_LockStatsLock);
+}
@@ -37,8 +37,12 @@
 #define __SpoutSharedMemory_
 
 #include "SpoutCommon.h"
+#include "SpoutStats.h"
 #include <windowsx.h>
 #include <wingdi.h>
+#include <atomic>
+#include <vector>
+#include <string>
 
 using namespace spoututils;
 
@@ -52,6 +56,29 @@ enum SpoutCreateResult {
 	SPOUT_ALREADY_CREATED,
 };
 
+//
+// Lock statistics for a named map.
+// Shared by every SpoutSharedMemory object in the process that uses the same name.
+//
+struct SpoutLockStats {
+
+	SpoutLockStats() : acquisitions(0), timeouts(0) {}
+	SpoutLockStats(const SpoutLockStats& other) { *this = other; }
+	SpoutLockStats& operator=(const SpoutLockStats& other) {
+		acquisitions.store(other.acquisitions.load());
+		timeouts.store(other.timeouts.load());
+		wait = other.wait;
+		hold = other.hold;
+		return *this;
+	}
+
+	std::atomic<uint64_t> acquisitions; // Mutex acquisitions (nested locks are not counted)
+	std::atomic<uint64_t> timeouts; // Waits that timed out or failed
+	spoutLogHistogram wait; // Microseconds waiting for the mutex
+	spoutLogHistogram hold; // Microseconds from acquisition to release
+
+};
+
 class SPOUT_DLLEXP SpoutSharedMemory {
 
 public:
@@ -60,7 +87,8 @@ public:
 	~SpoutSharedMemory();
 
 	// Create a new memory segment, or attach to an existing one
-	SpoutCreateResult Create(const char* name, int size);
+	// Optionally request large pages for big buffers
+	SpoutCreateResult Create(const char* name, int size, bool bLargePages = false);
 
 	// Open an existing memory map
 	bool Open(const char* name);
@@ -76,13 +104,37 @@ public:
 
 	// Name of an existing map
 	const char* Name();
+
+	// Buffer of an open map without locking
+	// For fields that are read and written with interlocked functions
+	char* Buffer();
 	
 	// Size of an existing map
 	int Size();
 
+	// Page size granted for a map created by this object
+	size_t PageSize();
+
 	// Print map information for debugging
 	void Debug();
 
+	//
+	// Lock instrumentation
+	//
+
+	// Enable or disable lock statistics for all maps in this process
+	static void EnableLockStats(bool bEnable = true);
+	// Lock statistics status
+	static bool IsLockStatsEnabled();
+	// Copy the statistics recorded for a map name
+	static bool GetLockStats(const char* name, SpoutLockStats& stats);
+	// Names of all maps with recorded statistics
+	static void GetLockStatsNames(std::vector<std::string>& names);
+	// Write the statistics for all maps to the Spout log
+	static void LogLockStats(bool bReset = false);
+	// Clear all recorded statistics
+	static void ResetLockStats();
+
 private:
 
 	char*  m_pBuffer; // Buffer pointer
@@ -91,6 +143,9 @@ private:
 	int m_lockCount; // Map access lock count
 	char* m_pName; // Map name
 	int m_size; // Map size
+	size_t m_pageSize; // Page size of the map view
+	SpoutLockStats* m_pLockStats; // Statistics for this map name if enabled
+	uint64_t m_lockStart; // Time of mutex acquisition (usec)
 
 };
 
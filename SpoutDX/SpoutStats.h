@@ -0,0 +1,186 @@
+/*
+
+	SpoutStats.h
+
+	Lightweight timing statistics used to instrument the Spout classes.
+
+	spoutLogHistogram records microsecond samples into power-of-two buckets.
+	Samples are added with relaxed atomic operations so that a histogram can be
+	updated from more than one thread and read at any time without a lock.
+	Percentiles are approximate and resolve to the upper bound of a bucket.
+
+*/
+#pragma once
+
+#ifndef __SpoutStats__
+#define __SpoutStats__
+
+#include <windows.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <atomic>
+#include <string>
+
+namespace spoutstats {
+
+	//
+	// Microseconds from the performance counter.
+	//
+	// The performance counter is system wide, so values written to shared memory
+	// by one process can be compared with values read in another.
+	//
+	inline uint64_t NowMicroseconds()
+	{
+		static const LONGLONG frequency = [] {
+			LARGE_INTEGER f = {};
+			QueryPerformanceFrequency(&f);
+			return f.QuadPart;
+		}();
+		LARGE_INTEGER now = {};
+		QueryPerformanceCounter(&now);
+		// Split to avoid overflow of the multiplication
+		const uint64_t seconds = static_cast<uint64_t>(now.QuadPart / frequency);
+		const uint64_t remainder = static_cast<uint64_t>(now.QuadPart % frequency);
+		return seconds * 1000000ULL + (remainder * 1000000ULL) / static_cast<uint64_t>(frequency);
+	}
+
+}
+
+class spoutLogHistogram {
+
+public:
+
+	// Bucket 0 holds samples below 1 usec, bucket n holds [2^(n-1), 2^n) usec.
+	// The last bucket collects everything above 2^30 usec (about 18 minutes).
+	static const int NumBuckets = 32;
+
+	spoutLogHistogram()
+	{
+		Reset();
+	}
+
+	spoutLogHistogram(const spoutLogHistogram& other)
+	{
+		*this = other;
+	}
+
+	// Snapshot copy. Not atomic as a whole, but each field is read atomically.
+	spoutLogHistogram& operator=(const spoutLogHistogram& other)
+	{
+		for (int i = 0; i < NumBuckets; i++)
+			m_Buckets[i].store(other.m_Buckets[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+		m_Count.store(other.m_Count.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		m_Total.store(other.m_Total.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		m_Min.store(other.m_Min.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		m_Max.store(other.m_Max.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		return *this;
+	}
+
+	void Reset()
+	{
+		for (int i = 0; i < NumBuckets; i++)
+			m_Buckets[i].store(0, std::memory_order_relaxed);
+		m_Count.store(0, std::memory_order_relaxed);
+		m_Total.store(0, std::memory_order_relaxed);
+		m_Min.store(UINT64_MAX, std::memory_order_relaxed);
+		m_Max.store(0, std::memory_order_relaxed);
+	}
+
+	// Add a sample in microseconds
+	void Add(uint64_t usec)
+	{
+		m_Buckets[BucketIndex(usec)].fetch_add(1, std::memory_order_relaxed);
+		m_Count.fetch_add(1, std::memory_order_relaxed);
+		m_Total.fetch_add(usec, std::memory_order_relaxed);
+
+		uint64_t current = m_Min.load(std::memory_order_relaxed);
+		while (usec < current && !m_Min.compare_exchange_weak(current, usec, std::memory_order_relaxed)) {}
+		current = m_Max.load(std::memory_order_relaxed);
+		while (usec > current && !m_Max.compare_exchange_weak(current, usec, std::memory_order_relaxed)) {}
+	}
+
+	// Add the samples of another histogram, e.g. from another thread or process
+	void Merge(const spoutLogHistogram& other)
+	{
+		if (other.Count() == 0)
+			return;
+		for (int i = 0; i < NumBuckets; i++)
+			m_Buckets[i].fetch_add(other.Bucket(i), std::memory_order_relaxed);
+		m_Count.fetch_add(other.Count(), std::memory_order_relaxed);
+		m_Total.fetch_add(other.Total(), std::memory_order_relaxed);
+
+		const uint64_t otherMin = other.Min();
+		uint64_t current = m_Min.load(std::memory_order_relaxed);
+		while (otherMin < current && !m_Min.compare_exchange_weak(current, otherMin, std::memory_order_relaxed)) {}
+		const uint64_t otherMax = other.Max();
+		current = m_Max.load(std::memory_order_relaxed);
+		while (otherMax > current && !m_Max.compare_exchange_weak(current, otherMax, std::memory_order_relaxed)) {}
+	}
+
+	uint64_t Count() const { return m_Count.load(std::memory_order_relaxed); }
+	uint64_t Total() const { return m_Total.load(std::memory_order_relaxed); }
+	uint64_t Max() const { return m_Max.load(std::memory_order_relaxed); }
+	uint64_t Min() const
+	{
+		const uint64_t value = m_Min.load(std::memory_order_relaxed);
+		return (value == UINT64_MAX) ? 0 : value;
+	}
+	double Mean() const
+	{
+		const uint64_t count = Count();
+		return count > 0 ? static_cast<double>(Total()) / static_cast<double>(count) : 0.0;
+	}
+	uint64_t Bucket(int index) const
+	{
+		return (index >= 0 && index < NumBuckets) ? m_Buckets[index].load(std::memory_order_relaxed) : 0;
+	}
+
+	// Approximate percentile (0 - 100) in microseconds
+	uint64_t Percentile(double percent) const
+	{
+		const uint64_t count = Count();
+		if (count == 0)
+			return 0;
+		uint64_t target = static_cast<uint64_t>((percent / 100.0) * static_cast<double>(count) + 0.5);
+		if (target < 1) target = 1;
+		uint64_t accumulated = 0;
+		for (int i = 0; i < NumBuckets; i++) {
+			accumulated += m_Buckets[i].load(std::memory_order_relaxed);
+			if (accumulated >= target) {
+				const uint64_t upper = (i == 0) ? 1 : (1ULL << i);
+				return (upper < Max()) ? upper : Max();
+			}
+		}
+		return Max();
+	}
+
+	// One line summary for logs
+	std::string Summary() const
+	{
+		char text[256] = {};
+		sprintf_s(text, 256, "n=%llu mean=%.1fus p50=%lluus p95=%lluus p99=%lluus max=%lluus",
+			Count(), Mean(), Percentile(50.0), Percentile(95.0), Percentile(99.0), Max());
+		return std::string(text);
+	}
+
+	static int BucketIndex(uint64_t usec)
+	{
+		int index = 0;
+		while (usec > 0 && index < NumBuckets - 1) {
+			usec >>= 1;
+			index++;
+		}
+		return index;
+	}
+
+private:
+
+	std::atomic<uint64_t> m_Buckets[NumBuckets];
+	std::atomic<uint64_t> m_Count;
+	std::atomic<uint64_t> m_Total;
+	std::atomic<uint64_t> m_Min;
+	std::atomic<uint64_t> m_Max;
+
+};
+
+#endif
@@ -0,0 +1,169 @@
+/*
+
+	SpoutFramePacerBench.cpp
+
+	Benchmark of frame rate control.
+
+	Frames are held at a target rate with spoutFramePacer and, for
+	comparison, with the sleep for the remainder of the frame that
+	HoldFps used before. Each frame does a fixed amount of busy work
+	to stand in for rendering.
+
+	For each method the achieved frame rate and the error of each frame
+	interval from the target period are reported. For the pacer, the
+	deviation of each frame from its deadline and the number of missed
+	deadlines are also reported.
+
+	Usage :
+
+		SpoutFramePacerBench [-fps F] [-seconds S] [-load L]
+
+		-fps      target frame rate, 0 for 60, 90, 120, 144 and 240 (default 0)
+		-seconds  duration of each run (default 5)
+		-load     busy work per frame in microseconds (default 2000)
+
+*/
+#include "SpoutFramePacer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace {
+
+	const int DefaultRates[] = { 60, 90, 120, 144, 240 };
+
+	struct RunResult {
+		uint64_t frames;
+		double achievedFps;
+		spoutLogHistogram intervalError; // |interval - period| in usec
+	};
+
+	void BusyWork(int usec)
+	{
+		const uint64_t end = spoutstats::NowMicroseconds() + static_cast<uint64_t>(usec);
+		while (spoutstats::NowMicroseconds() < end)
+			YieldProcessor();
+	}
+
+	void AddInterval(RunResult& result, uint64_t interval, double period)
+	{
+		const double error = static_cast<double>(interval) - period;
+		result.intervalError.Add(static_cast<uint64_t>(error < 0.0 ? -error : error));
+	}
+
+	// Frames held by spoutFramePacer
+	void RunPacer(int fps, int seconds, int load, RunResult& result, spoutFramePacer& pacer)
+	{
+		const double period = 1000000.0 / static_cast<double>(fps);
+		pacer.SetFps(static_cast<double>(fps));
+		pacer.Wait(); // Start of the schedule
+
+		const uint64_t start = spoutstats::NowMicroseconds();
+		const uint64_t end = start + static_cast<uint64_t>(seconds) * 1000000ULL;
+		uint64_t last = start;
+		uint64_t now = start;
+		result.frames = 0;
+		while (now < end) {
+			BusyWork(load);
+			pacer.Wait();
+			now = spoutstats::NowMicroseconds();
+			AddInterval(result, now - last, period);
+			last = now;
+			result.frames++;
+		}
+		result.achievedFps = static_cast<double>(result.frames) * 1000000.0 / static_cast<double>(now - start);
+		pacer.SetFps(0.0);
+	}
+
+	// Frames held by sleeping for the rest of the frame time in whole
+	// milliseconds, measured from the end of the previous wait
+	void RunSleep(int fps, int seconds, int load, RunResult& result)
+	{
+		const double period = 1000000.0 / static_cast<double>(fps);
+
+		TIMECAPS tc = {};
+		UINT periodMin = 0;
+		if (timeGetDevCaps(&tc, sizeof(TIMECAPS)) == MMSYSERR_NOERROR && timeBeginPeriod(tc.wPeriodMin) == TIMERR_NOERROR)
+			periodMin = tc.wPeriodMin;
+
+		const uint64_t start = spoutstats::NowMicroseconds();
+		const uint64_t end = start + static_cast<uint64_t>(seconds) * 1000000ULL;
+		uint64_t last = start;
+		uint64_t now = start;
+		result.frames = 0;
+		while (now < end) {
+			BusyWork(load);
+			const double elapsed = static_cast<double>(spoutstats::NowMicroseconds() - last);
+			if (elapsed < period)
+				Sleep(static_cast<DWORD>((period - elapsed) / 1000.0));
+			now = spoutstats::NowMicroseconds();
+			AddInterval(result, now - last, period);
+			last = now;
+			result.frames++;
+		}
+		result.achievedFps = static_cast<double>(result.frames) * 1000000.0 / static_cast<double>(now - start);
+
+		if (periodMin > 0)
+			timeEndPeriod(periodMin);
+	}
+
+	void PrintResult(int fps, const char* method, const RunResult& result)
+	{
+		printf("%5d  %-6s  %7llu  %8.2f  %7llu  %7llu  %7llu",
+			fps, method, result.frames, result.achievedFps,
+			result.intervalError.Percentile(50.0), result.intervalError.Percentile(99.0), result.intervalError.Max());
+	}
+
+	int ArgValue(int argc, char* argv[], const char* option, int defaultValue, int minValue, int maxValue)
+	{
+		for (int i = 1; i < argc - 1; i++) {
+			if (strcmp(argv[i], option) == 0) {
+				int value = atoi(argv[i + 1]);
+				if (value < minValue) value = minValue;
+				if (value > maxValue) value = maxValue;
+				return value;
+			}
+		}
+		return defaultValue;
+	}
+
+}
+
+int main(int argc, char* argv[])
+{
+	const int fps = ArgValue(argc, argv, "-fps", 0, 0, 1000);
+	const int seconds = ArgValue(argc, argv, "-seconds", 5, 1, 3600);
+	const int load = ArgValue(argc, argv, "-load", 2000, 0, 1000000);
+
+	spoutFramePacer pacer;
+
+	printf("Spout frame pacer benchmark - %d seconds per run, %d usec of work per frame\n", seconds, load);
+	printf("Sleep uses a %s\n", pacer.IsHighResolutionTimer() ? "high resolution waitable timer" : "1 msec timer period");
+	printf("Times in microseconds. Percentiles are the upper bound of a power of two bucket.\n\n");
+	printf("%5s  %-6s  %7s  %8s  %7s  %7s  %7s  %9s  %9s  %6s  %6s\n",
+		"fps", "method", "frames", "achieved", "int p50", "int p99", "int max", "dline p50", "dline p99", "missed", "margin");
+
+	for (int i = 0; i < (int)(sizeof(DefaultRates) / sizeof(DefaultRates[0])); i++) {
+		const int rate = (fps > 0) ? fps : DefaultRates[i];
+
+		RunResult sleepResult;
+		RunSleep(rate, seconds, load, sleepResult);
+		PrintResult(rate, "sleep", sleepResult);
+		printf("\n");
+
+		RunResult pacerResult;
+		pacer.ResetStats();
+		RunPacer(rate, seconds, load, pacerResult, pacer);
+		spoutLogHistogram jitter;
+		pacer.GetJitter(jitter);
+		PrintResult(rate, "pacer", pacerResult);
+		printf("  %9llu  %9llu  %6llu  %6.0f\n",
+			jitter.Percentile(50.0), jitter.Percentile(99.0), pacer.GetMissed(), pacer.GetSpinMargin());
+
+		if (fps > 0)
+			break;
+	}
+
+	return 0;
+}
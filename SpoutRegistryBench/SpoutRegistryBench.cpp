@@ -0,0 +1,309 @@
+/*
+
+	SpoutRegistryBench.cpp
+
+	Stress test and benchmark of the Spout sender registry.
+
+	Senders are registered, looked up, updated and released from several
+	processes at the same time, for an increasing number of senders.
+	The latency of each operation is recorded in a histogram and the
+	percentiles are reported for each number of senders, as a baseline
+	for changes to the sender registry.
+
+	Usage :
+
+		SpoutRegistryBench [-senders N] [-processes P] [-iterations I]
+
+		-senders     maximum number of senders, 1 to 4096 (default 4096)
+		             Runs 1, 4, 16, 64 ... up to this number
+		-processes   number of processes sharing the senders, 1 to 64 (default 4)
+		-iterations  repeats of the lookup and update phases (default 10)
+
+	The sender name list is created with room for the number of senders
+	being tested. If another Spout application has the list open, its size
+	is fixed and senders beyond it are registered in the hashed index only.
+	Senders that could not be registered at all are reported.
+
+	The benchmark starts copies of itself with "-child" for each process.
+
+*/
+#include "SpoutSenderNames.h"
+#include "SpoutStats.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+#include <vector>
+
+namespace {
+
+	const int MaxSenders = 4096;
+	const int MaxProcesses = MAXIMUM_WAIT_OBJECTS;
+
+	// Longest wait at a barrier for the other processes, in case one of them hangs
+	const ULONGLONG BarrierTimeoutMs = 300000;
+
+	enum BenchOp {
+		OpRegister,
+		OpLookup,
+		OpUpdate,
+		OpHeartbeat,
+		OpList,
+		OpPattern,
+		OpRelease,
+		NumOps
+	};
+
+	const char* OpNames[NumOps] = {
+		"register", "lookup", "update", "heartbeat", "list", "pattern", "release"
+	};
+
+	// Results shared by all processes of a run
+	struct BenchResults {
+		volatile LONG barrier; // Number of processes that have reached a phase
+		volatile LONG refused; // Senders that could not be registered
+		volatile LONG abort; // Set when a process fails, the others stop at the next barrier
+		spoutLogHistogram histograms[MaxProcesses][NumOps];
+	};
+
+	const char* ResultsMapName = "SpoutRegistryBenchResults";
+
+	// The maximum number of senders is normally read from the registry.
+	// Set it for this process only so that the user's setting is unchanged.
+	class benchSenderNames : public spoutSenderNames {
+	public:
+		void SetLocalMaxSenders(int maxSenders) {
+			m_MaxSenders = maxSenders;
+		}
+	};
+
+	void SenderName(int index, char* name)
+	{
+		sprintf_s(name, 256, "RegistryBench_%05d", index);
+	}
+
+	// Wait for all processes to reach the same phase.
+	// Returns false if the run has been aborted, or if the other processes
+	// do not arrive within the timeout, which aborts the run.
+	bool Barrier(BenchResults* pResults, int nProcesses, int phase)
+	{
+		InterlockedIncrement(&pResults->barrier);
+		const ULONGLONG start = GetTickCount64();
+		while (InterlockedCompareExchange(&pResults->barrier, 0, 0) < (LONG)(nProcesses * phase)) {
+			if (InterlockedCompareExchange(&pResults->abort, 0, 0) != 0)
+				return false;
+			if (GetTickCount64() - start > BarrierTimeoutMs) {
+				InterlockedExchange(&pResults->abort, 1);
+				return false;
+			}
+			Sleep(0);
+		}
+		return true;
+	}
+
+	//
+	// Child process
+	//
+	// Registers the senders with index % nProcesses == index of the process,
+	// looks up all senders, updates its own and releases them.
+	//
+	int RunChild(int processIndex, int nProcesses, int nSenders, int nIterations)
+	{
+		SpoutSharedMemory resultsMap;
+		if (!resultsMap.Open(ResultsMapName)) {
+			printf("Child %d - could not open results\n", processIndex);
+			return 1;
+		}
+		BenchResults* pResults = reinterpret_cast<BenchResults*>(resultsMap.Buffer());
+		spoutLogHistogram* histograms = pResults->histograms[processIndex];
+
+		benchSenderNames names;
+		names.SetLocalMaxSenders(nSenders > 64 ? nSenders : 64);
+
+		char name[256] = {};
+		std::vector<int> ownSenders;
+		for (int i = processIndex; i < nSenders; i += nProcesses)
+			ownSenders.push_back(i);
+
+		int phase = 1;
+		if (!Barrier(pResults, nProcesses, phase++)) {
+			printf("Child %d - run aborted\n", processIndex);
+			return 1;
+		}
+
+		// Register
+		for (size_t i = 0; i < ownSenders.size(); i++) {
+			SenderName(ownSenders[i], name);
+			const uint64_t start = spoutstats::NowMicroseconds();
+			names.CreateSender(name, 640, 360, (HANDLE)(uintptr_t)(ownSenders[i] + 1), 87);
+			histograms[OpRegister].Add(spoutstats::NowMicroseconds() - start);
+			if (!names.FindSenderName(name))
+				InterlockedIncrement(&pResults->refused);
+		}
+		bool bRun = Barrier(pResults, nProcesses, phase++);
+
+		for (int iteration = 0; bRun && iteration < nIterations; iteration++) {
+
+			// Look up every sender
+			for (int i = 0; i < nSenders; i++) {
+				SenderName(i, name);
+				const uint64_t start = spoutstats::NowMicroseconds();
+				names.FindSenderName(name);
+				histograms[OpLookup].Add(spoutstats::NowMicroseconds() - start);
+			}
+
+			// Update the sender information and renew the lease, as for a frame
+			for (size_t i = 0; i < ownSenders.size(); i++) {
+				SenderName(ownSenders[i], name);
+				uint64_t start = spoutstats::NowMicroseconds();
+				names.UpdateSender(name, 640 + iteration, 360, (HANDLE)(uintptr_t)(ownSenders[i] + 1), 87);
+				histograms[OpUpdate].Add(spoutstats::NowMicroseconds() - start);
+				start = spoutstats::NowMicroseconds();
+				names.SenderHeartbeat(name);
+				histograms[OpHeartbeat].Add(spoutstats::NowMicroseconds() - start);
+			}
+
+			// Read the sender list and resolve a pattern
+			uint64_t start = spoutstats::NowMicroseconds();
+			names.GetSenderCount();
+			histograms[OpList].Add(spoutstats::NowMicroseconds() - start);
+			start = spoutstats::NowMicroseconds();
+			names.FindSenderPattern("RegistryBench_*", name, 256, true);
+			histograms[OpPattern].Add(spoutstats::NowMicroseconds() - start);
+		}
+		bRun = bRun && Barrier(pResults, nProcesses, phase++);
+
+		// Release, also when the run has been aborted
+		for (size_t i = 0; i < ownSenders.size(); i++) {
+			SenderName(ownSenders[i], name);
+			const uint64_t start = spoutstats::NowMicroseconds();
+			names.ReleaseSenderName(name);
+			histograms[OpRelease].Add(spoutstats::NowMicroseconds() - start);
+		}
+
+		if (!bRun) {
+			printf("Child %d - run aborted\n", processIndex);
+			return 1;
+		}
+
+		return 0;
+	}
+
+	//
+	// Parent process
+	//
+	// Runs the children for one number of senders and prints the results.
+	//
+	bool RunSize(int nSenders, int nProcesses, int nIterations)
+	{
+		SpoutSharedMemory resultsMap;
+		if (resultsMap.Create(ResultsMapName, (int)sizeof(BenchResults)) == SPOUT_CREATE_FAILED) {
+			printf("Could not create results map\n");
+			return false;
+		}
+		char* pBuf = resultsMap.Buffer();
+		memset(pBuf, 0, sizeof(BenchResults));
+		BenchResults* pResults = new (pBuf) BenchResults();
+
+		// Children fewer than the senders would have nothing to register
+		const int nChildren = (nProcesses < nSenders) ? nProcesses : nSenders;
+
+		char path[MAX_PATH] = {};
+		GetModuleFileNameA(NULL, path, MAX_PATH);
+
+		std::vector<HANDLE> processes;
+		for (int i = 0; i < nChildren; i++) {
+			char command[MAX_PATH + 64] = {};
+			sprintf_s(command, MAX_PATH + 64, "\"%s\" -child %d %d %d %d", path, i, nChildren, nSenders, nIterations);
+			STARTUPINFOA si = {};
+			si.cb = sizeof(si);
+			PROCESS_INFORMATION pi = {};
+			if (!CreateProcessA(NULL, command, NULL, NULL, FALSE, 0, NULL, NULL, &si, &pi)) {
+				printf("Could not start child process %d (%lu)\n", i, GetLastError());
+				// The children that have started stop at their next barrier
+				InterlockedExchange(&pResults->abort, 1);
+				break;
+			}
+			CloseHandle(pi.hThread);
+			processes.push_back(pi.hProcess);
+		}
+
+		// A child that fails, such as one that cannot open the results,
+		// would leave the others waiting for it at a barrier
+		while (!processes.empty()
+			&& WaitForMultipleObjects((DWORD)processes.size(), processes.data(), TRUE, 100) == WAIT_TIMEOUT) {
+			for (size_t i = 0; i < processes.size(); i++) {
+				DWORD dwExitCode = 0;
+				if (GetExitCodeProcess(processes[i], &dwExitCode) && dwExitCode != STILL_ACTIVE && dwExitCode != 0)
+					InterlockedExchange(&pResults->abort, 1);
+			}
+		}
+
+		bool bResult = ((int)processes.size() == nChildren);
+		for (size_t i = 0; i < processes.size(); i++) {
+			DWORD dwExitCode = 0;
+			if (!GetExitCodeProcess(processes[i], &dwExitCode) || dwExitCode != 0)
+				bResult = false;
+			CloseHandle(processes[i]);
+		}
+
+		for (int op = 0; op < NumOps; op++) {
+			spoutLogHistogram total;
+			for (int i = 0; i < nChildren; i++)
+				total.Merge(pResults->histograms[i][op]);
+			printf("%7d  %-9s  %9llu  %9.1f  %7llu  %7llu  %7llu  %8llu\n",
+				nSenders, OpNames[op], total.Count(), total.Mean(),
+				total.Percentile(50.0), total.Percentile(95.0), total.Percentile(99.0), total.Max());
+		}
+		if (pResults->refused > 0)
+			printf("%7d  %ld senders could not be registered\n", nSenders, pResults->refused);
+		if (pResults->abort != 0) {
+			printf("%7d  run aborted, the results are incomplete\n", nSenders);
+			bResult = false;
+		}
+		printf("\n");
+
+		return bResult;
+	}
+
+	int ArgValue(int argc, char* argv[], const char* option, int defaultValue, int minValue, int maxValue)
+	{
+		for (int i = 1; i < argc - 1; i++) {
+			if (strcmp(argv[i], option) == 0) {
+				int value = atoi(argv[i + 1]);
+				if (value < minValue) value = minValue;
+				if (value > maxValue) value = maxValue;
+				return value;
+			}
+		}
+		return defaultValue;
+	}
+
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc == 6 && strcmp(argv[1], "-child") == 0)
+		return RunChild(atoi(argv[2]), atoi(argv[3]), atoi(argv[4]), atoi(argv[5]));
+
+	const int nSenders = ArgValue(argc, argv, "-senders", MaxSenders, 1, MaxSenders);
+	const int nProcesses = ArgValue(argc, argv, "-processes", 4, 1, MaxProcesses);
+	const int nIterations = ArgValue(argc, argv, "-iterations", 10, 1, 100000);
+
+	printf("Spout sender registry benchmark - %d processes, %d iterations\n", nProcesses, nIterations);
+	printf("Latency in microseconds. Percentiles are the upper bound of a power of two bucket.\n\n");
+	printf("%7s  %-9s  %9s  %9s  %7s  %7s  %7s  %8s\n", "senders", "operation", "count", "mean", "p50", "p95", "p99", "max");
+
+	bool bResult = true;
+	for (int n = 1; ; n *= 4) {
+		if (n > nSenders)
+			n = nSenders;
+		if (!RunSize(n, nProcesses, nIterations))
+			bResult = false;
+		if (n == nSenders)
+			break;
+	}
+
+	return bResult ? 0 : 1;
+}
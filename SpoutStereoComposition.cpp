@@ -0,0 +1,129 @@
+#include "pch.h"
+#include "SpoutStereoComposition.h"
+
+#include <cstring>
+
+using Microsoft::WRL::ComPtr;
+
+
+SpoutStereoInstancedComposition::SpoutStereoInstancedComposition() :
+    m_textureArray(nullptr),
+    m_textureArrayView(nullptr),
+    m_textureArrayDesc()
+{
+}
+
+SpoutStereoInstancedComposition::~SpoutStereoInstancedComposition()
+{
+    ReleaseDeviceResources();
+}
+
+bool
+SpoutStereoInstancedComposition::Prepare(SpoutStereoGraphics* graphics, const std::vector<SpoutStereoQuadSource>& sources)
+{
+    m_instances.clear();
+    if (sources.size() > SpoutStereoMaxQuadInstances) {
+        return false;
+    }
+
+    // Every texture must match the first, and tiles without a view only match each other
+    D3D11_TEXTURE2D_DESC desc = {};
+    std::vector<ComPtr<ID3D11Resource>> textures(sources.size());
+    for (size_t i = 0; i < sources.size(); i++) {
+        if (sources[i].view == nullptr) {
+            if (i > 0 && textures[0]) {
+                return false;
+            }
+            continue;
+        }
+        sources[i].view->GetResource(&textures[i]);
+        ComPtr<ID3D11Texture2D> texture;
+        if (FAILED(textures[i].As(&texture))) {
+            return false;
+        }
+        D3D11_TEXTURE2D_DESC textureDesc;
+        texture->GetDesc(&textureDesc);
+        // Copy as the format the tile draws with, which may be a typed format of a typeless texture
+        D3D11_SHADER_RESOURCE_VIEW_DESC viewDesc;
+        sources[i].view->GetDesc(&viewDesc);
+        if (viewDesc.ViewDimension != D3D11_SRV_DIMENSION_TEXTURE2D || textureDesc.SampleDesc.Count != 1) {
+            return false;
+        }
+        if (i == 0) {
+            desc.Width = textureDesc.Width;
+            desc.Height = textureDesc.Height;
+            desc.Format = viewDesc.Format;
+        }
+        else if (!textures[0] || textureDesc.Width != desc.Width || textureDesc.Height != desc.Height || viewDesc.Format != desc.Format) {
+            return false;
+        }
+    }
+    if (sources.empty()) {
+        return true;
+    }
+
+    desc.MipLevels = 1;
+    desc.ArraySize = (UINT)sources.size();
+    desc.SampleDesc.Count = 1;
+    desc.Usage = D3D11_USAGE_DEFAULT;
+    desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+    if (m_slices.empty() || memcmp(&desc, &m_textureArrayDesc, sizeof(desc)) != 0) {
+        ReleaseDeviceResources();
+        if (FAILED(graphics->CreateTexture(desc, nullptr, &m_textureArray))) {
+            return false;
+        }
+        if (m_textureArray != nullptr) {
+            D3D11_SHADER_RESOURCE_VIEW_DESC viewDesc = {};
+            viewDesc.Format = desc.Format;
+            viewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+            viewDesc.Texture2DArray.MipLevels = 1;
+            viewDesc.Texture2DArray.ArraySize = desc.ArraySize;
+            if (FAILED(graphics->CreateShaderResourceView(m_textureArray, &viewDesc, &m_textureArrayView))) {
+                ReleaseDeviceResources();
+                return false;
+            }
+        }
+        m_textureArrayDesc = desc;
+        m_slices.resize(sources.size());
+    }
+
+    // Copy the slices whose texture or frame changed, or whose frame is not known
+    for (size_t i = 0; i < sources.size(); i++) {
+        Slice& slice = m_slices[i];
+        if (slice.texture != textures[i] || slice.frame != sources[i].frame || sources[i].frame == 0) {
+            graphics->CopyToArraySlice(m_textureArray, (UINT)i, textures[i].Get());
+            slice.texture = textures[i];
+            slice.frame = sources[i].frame;
+        }
+        SpoutStereoQuadInstance instance;
+        instance.viewport = sources[i].viewport;
+        instance.slice = (UINT)i;
+        m_instances.push_back(instance);
+    }
+    return true;
+}
+
+void
+SpoutStereoInstancedComposition::Draw(SpoutStereoGraphics* graphics, ID3D11SamplerState* sampler)
+{
+    if (m_instances.empty()) {
+        return;
+    }
+    graphics->DrawInstancedQuads(m_textureArrayView, sampler, m_instances.data(), (UINT)m_instances.size());
+}
+
+void
+SpoutStereoInstancedComposition::ReleaseDeviceResources()
+{
+    if (m_textureArrayView != nullptr) {
+        m_textureArrayView->Release();
+        m_textureArrayView = nullptr;
+    }
+    if (m_textureArray != nullptr) {
+        m_textureArray->Release();
+        m_textureArray = nullptr;
+    }
+    m_textureArrayDesc = D3D11_TEXTURE2D_DESC();
+    m_slices.clear();
+    m_instances.clear();
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "pch.h"
+#include "SpoutStereoGraphics.h"
+
+#include <vector>
+
+// What a tile shows in one eye, for the instanced composition
+struct SpoutStereoQuadSource
+{
+    ID3D11ShaderResourceView* view = nullptr;
+    // Sender frame number of the view's texture, 0 if unknown and -1 if the texture never changes
+    long frame = 0;
+    D3D11_VIEWPORT viewport = {};
+};
+
+// COMPOSITION_MODE = instanced, draws the quads of all tiles in one eye with a
+// single instanced draw. Each tile's texture is copied into a slice of a texture
+// array when its frame changes, so the textures must all have the same size
+// and format; if not, the tiles draw themselves one quad at a time.
+class SpoutStereoInstancedComposition
+{
+public:
+    SpoutStereoInstancedComposition();
+    virtual ~SpoutStereoInstancedComposition();
+
+    // Copies the sources' new frames into the texture array, which is created again when the
+    // number of sources or their size or format changes. Returns false if they cannot share it.
+    bool Prepare(SpoutStereoGraphics* graphics, const std::vector<SpoutStereoQuadSource>& sources);
+
+    // Draws the prepared quads into the render target that is set
+    void Draw(SpoutStereoGraphics* graphics, ID3D11SamplerState* sampler);
+
+    void ReleaseDeviceResources();
+
+protected:
+    // The texture in each slice, referenced so that a new texture cannot take its address
+    struct Slice {
+        Microsoft::WRL::ComPtr<ID3D11Resource> texture;
+        long frame = 0;
+    };
+
+    ID3D11Texture2D* m_textureArray;
+    ID3D11ShaderResourceView* m_textureArrayView;
+    D3D11_TEXTURE2D_DESC m_textureArrayDesc;
+    std::vector<Slice> m_slices;
+    std::vector<SpoutStereoQuadInstance> m_instances;
+};
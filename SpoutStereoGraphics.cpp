@@ -0,0 +1,483 @@
+#include "pch.h"
+#include "SpoutStereoGraphics.h"
+#include "Generated Files/InstancedPixelShader.h"
+#include "Generated Files/InstancedVertexShader.h"
+#include "Generated Files/PixelShader.h"
+#include "Generated Files/VertexShader.h"
+
+#include <minvr3.h>
+
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+using Microsoft::WRL::ComPtr;
+
+// An element of the instanced vertex shader's constant buffer
+struct QuadInstanceConstants
+{
+    float rect[4]; // left, top, width and height in normalized device coordinates
+    UINT slice[4];
+};
+
+
+std::unique_ptr<SpoutStereoGraphics>
+SpoutStereoGraphics::Create(const std::string& backend, ComPtr<ID3D11Device> d3dDevice, ComPtr<ID3D11DeviceContext> d3dContext)
+{
+    if (backend == "null") {
+        return std::unique_ptr<SpoutStereoGraphics>(new SpoutStereoGraphicsNull());
+    }
+    if (backend == "software") {
+        // By default one band for each core, including the main loop's thread
+        int threads = ConfigVal::Get("SOFTWARE_COMPOSITOR_THREADS", 0);
+        if (threads <= 0) {
+            threads = (int)std::thread::hardware_concurrency();
+        }
+        return std::unique_ptr<SpoutStereoGraphics>(new SpoutStereoGraphicsSoftware(d3dDevice, d3dContext, (std::max)(threads - 1, 0)));
+    }
+    if (backend != "d3d11") {
+        std::cout << "Warning: Unknown GRAPHICS_BACKEND '" << backend << "', using d3d11" << std::endl;
+    }
+    return std::unique_ptr<SpoutStereoGraphics>(new SpoutStereoGraphicsD3D11(d3dDevice, d3dContext));
+}
+
+bool
+SpoutStereoGraphics::changeViewport(const D3D11_VIEWPORT& viewport)
+{
+    if (m_state.viewportBound && memcmp(&m_state.viewport, &viewport, sizeof(viewport)) == 0) {
+        m_counters.stateSetsElided++;
+        return false;
+    }
+    m_state.viewportBound = true;
+    m_state.viewport = viewport;
+    return true;
+}
+
+bool
+SpoutStereoGraphics::changeRenderTarget(ID3D11RenderTargetView* renderTargetView)
+{
+    if (m_state.renderTargetBound && m_state.renderTargetView == renderTargetView) {
+        m_counters.stateSetsElided++;
+        return false;
+    }
+    m_state.renderTargetBound = true;
+    m_state.renderTargetView = renderTargetView;
+    return true;
+}
+
+bool
+SpoutStereoGraphics::changePipeline(SpoutStereoGraphicsPipeline pipeline, int calls)
+{
+    // Counted as the calls that set it
+    if (m_state.pipeline == pipeline) {
+        m_counters.stateSetsElided += calls;
+        return false;
+    }
+    m_counters.stateSets += calls;
+    m_state.pipeline = pipeline;
+    return true;
+}
+
+bool
+SpoutStereoGraphics::changeSampler(ID3D11SamplerState* sampler)
+{
+    if (m_state.samplerBound && m_state.sampler == sampler) {
+        m_counters.stateSetsElided++;
+        return false;
+    }
+    m_counters.stateSets++;
+    m_state.samplerBound = true;
+    m_state.sampler = sampler;
+    return true;
+}
+
+bool
+SpoutStereoGraphics::changeTextureView(ID3D11ShaderResourceView* textureView)
+{
+    if (m_state.textureViewBound && m_state.textureView == textureView) {
+        m_counters.stateSetsElided++;
+        return false;
+    }
+    m_counters.stateSets++;
+    m_state.textureViewBound = true;
+    m_state.textureView = textureView;
+    return true;
+}
+
+
+SpoutStereoGraphicsD3D11::SpoutStereoGraphicsD3D11(ComPtr<ID3D11Device> d3dDevice, ComPtr<ID3D11DeviceContext> d3dContext) :
+    m_d3dDevice(d3dDevice),
+    m_d3dContext(d3dContext),
+    m_targetWidth(0),
+    m_targetHeight(0)
+{
+    // Create simple shaders for fullscreen quad (these are compiled into header files during the build)
+    // Right-click on the .hlsl files and go to Properties to configure this.
+    DX::ThrowIfFailed(
+        m_d3dDevice->CreateVertexShader(g_vertexshader, sizeof(g_vertexshader), nullptr, &m_fullscreenVertexShader)
+    );
+    DX::ThrowIfFailed(
+        m_d3dDevice->CreatePixelShader(g_pixelshader, sizeof(g_pixelshader), nullptr, &m_fullscreenPixelShader)
+    );
+
+    DX::ThrowIfFailed(
+        m_d3dDevice->CreateVertexShader(g_instancedvertexshader, sizeof(g_instancedvertexshader), nullptr, &m_instancedVertexShader)
+    );
+    DX::ThrowIfFailed(
+        m_d3dDevice->CreatePixelShader(g_instancedpixelshader, sizeof(g_instancedpixelshader), nullptr, &m_instancedPixelShader)
+    );
+    CD3D11_BUFFER_DESC instanceBufferDesc(sizeof(QuadInstanceConstants) * SpoutStereoMaxQuadInstances,
+        D3D11_BIND_CONSTANT_BUFFER, D3D11_USAGE_DYNAMIC, D3D11_CPU_ACCESS_WRITE);
+    DX::ThrowIfFailed(
+        m_d3dDevice->CreateBuffer(&instanceBufferDesc, nullptr, &m_instanceBuffer)
+    );
+}
+
+SpoutStereoGraphicsD3D11::~SpoutStereoGraphicsD3D11()
+{
+}
+
+HRESULT
+SpoutStereoGraphicsD3D11::CreateTexture(const D3D11_TEXTURE2D_DESC& desc, const D3D11_SUBRESOURCE_DATA* data, ID3D11Texture2D** texture)
+{
+    m_counters.texturesCreated++;
+    return m_d3dDevice->CreateTexture2D(&desc, data, texture);
+}
+
+HRESULT
+SpoutStereoGraphicsD3D11::CreateShaderResourceView(ID3D11Resource* resource, const D3D11_SHADER_RESOURCE_VIEW_DESC* desc, ID3D11ShaderResourceView** view)
+{
+    m_counters.viewsCreated++;
+    return m_d3dDevice->CreateShaderResourceView(resource, desc, view);
+}
+
+HRESULT
+SpoutStereoGraphicsD3D11::CreateSamplerState(const D3D11_SAMPLER_DESC& desc, ID3D11SamplerState** sampler)
+{
+    m_counters.samplersCreated++;
+    return m_d3dDevice->CreateSamplerState(&desc, sampler);
+}
+
+void
+SpoutStereoGraphicsD3D11::SetViewport(const D3D11_VIEWPORT& viewport)
+{
+    if (!changeViewport(viewport)) {
+        return;
+    }
+    m_counters.viewportsSet++;
+    m_d3dContext->RSSetViewports(1, &viewport);
+}
+
+void
+SpoutStereoGraphicsD3D11::SetRenderTarget(ID3D11RenderTargetView* renderTargetView)
+{
+    if (!changeRenderTarget(renderTargetView)) {
+        return;
+    }
+    m_counters.renderTargetsSet++;
+    m_d3dContext->OMSetRenderTargets(1, &renderTargetView, nullptr);
+
+    m_targetWidth = 0;
+    m_targetHeight = 0;
+    if (renderTargetView != nullptr) {
+        ComPtr<ID3D11Resource> resource;
+        renderTargetView->GetResource(&resource);
+        ComPtr<ID3D11Texture2D> texture;
+        if (SUCCEEDED(resource.As(&texture))) {
+            D3D11_TEXTURE2D_DESC desc;
+            texture->GetDesc(&desc);
+            m_targetWidth = desc.Width;
+            m_targetHeight = desc.Height;
+        }
+    }
+}
+
+void
+SpoutStereoGraphicsD3D11::ClearRenderTarget(ID3D11RenderTargetView* renderTargetView, const float color[4])
+{
+    m_counters.clears++;
+    m_d3dContext->ClearRenderTargetView(renderTargetView, color);
+}
+
+void
+SpoutStereoGraphicsD3D11::DrawFullscreenQuad(ID3D11ShaderResourceView* textureView, ID3D11SamplerState* sampler)
+{
+    m_counters.quadsDrawn++;
+    if (changePipeline(SpoutStereoGraphicsPipeline::Quad, 3)) {
+        // The vertex shader generates the quad's four vertices from their ids
+        m_d3dContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+        m_d3dContext->VSSetShader(m_fullscreenVertexShader.Get(), nullptr, 0);
+        m_d3dContext->PSSetShader(m_fullscreenPixelShader.Get(), nullptr, 0);
+    }
+    if (changeSampler(sampler)) {
+        m_d3dContext->PSSetSamplers(0, 1, &sampler);
+    }
+    if (changeTextureView(textureView)) {
+        m_d3dContext->PSSetShaderResources(0, 1, &textureView);
+    }
+    m_d3dContext->Draw(4, 0);
+}
+
+void
+SpoutStereoGraphicsD3D11::CopyToArraySlice(ID3D11Texture2D* textureArray, UINT slice, ID3D11Resource* source)
+{
+    m_counters.arraySlicesCopied++;
+    m_d3dContext->CopySubresourceRegion(textureArray, D3D11CalcSubresource(0, slice, 1), 0, 0, 0, source, 0, nullptr);
+}
+
+void
+SpoutStereoGraphicsD3D11::DrawInstancedQuads(ID3D11ShaderResourceView* textureArrayView, ID3D11SamplerState* sampler,
+                                             const SpoutStereoQuadInstance* instances, UINT count)
+{
+    m_counters.instancedDraws++;
+    m_counters.instancedQuads += count;
+    if (count == 0 || count > SpoutStereoMaxQuadInstances || m_targetWidth == 0 || m_targetHeight == 0) {
+        return;
+    }
+
+    // Place the instances in normalized device coordinates of the whole render target
+    D3D11_MAPPED_SUBRESOURCE mapped = {};
+    if (FAILED(m_d3dContext->Map(m_instanceBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped))) {
+        return;
+    }
+    QuadInstanceConstants* constants = (QuadInstanceConstants*)mapped.pData;
+    float scaleX = 2.0f / (float)m_targetWidth;
+    float scaleY = 2.0f / (float)m_targetHeight;
+    for (UINT i = 0; i < count; i++) {
+        const D3D11_VIEWPORT& viewport = instances[i].viewport;
+        constants[i].rect[0] = viewport.TopLeftX * scaleX - 1.0f;
+        constants[i].rect[1] = 1.0f - viewport.TopLeftY * scaleY;
+        constants[i].rect[2] = viewport.Width * scaleX;
+        constants[i].rect[3] = viewport.Height * scaleY;
+        constants[i].slice[0] = instances[i].slice;
+    }
+    m_d3dContext->Unmap(m_instanceBuffer.Get(), 0);
+
+    SetViewport(CD3D11_VIEWPORT(0.0f, 0.0f, (float)m_targetWidth, (float)m_targetHeight));
+    if (changePipeline(SpoutStereoGraphicsPipeline::InstancedQuads, 4)) {
+        m_d3dContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+        m_d3dContext->VSSetShader(m_instancedVertexShader.Get(), nullptr, 0);
+        m_d3dContext->VSSetConstantBuffers(0, 1, m_instanceBuffer.GetAddressOf());
+        m_d3dContext->PSSetShader(m_instancedPixelShader.Get(), nullptr, 0);
+    }
+    if (changeSampler(sampler)) {
+        m_d3dContext->PSSetSamplers(0, 1, &sampler);
+    }
+    if (changeTextureView(textureArrayView)) {
+        m_d3dContext->PSSetShaderResources(0, 1, &textureArrayView);
+    }
+    m_d3dContext->DrawInstanced(4, count, 0, 0);
+}
+
+HRESULT
+SpoutStereoGraphicsD3D11::Present(IDXGISwapChain* swapChain, UINT syncInterval)
+{
+    m_counters.presents++;
+    // The flip model unbinds the back buffer
+    m_state.renderTargetBound = false;
+    return swapChain->Present(syncInterval, 0);
+}
+
+
+namespace {
+
+    // Stands in for a resource, view or sampler created by the null backend, so
+    // that the tiles see created objects as they do with D3D11. Only reference
+    // counting and the descriptions work, there is no device.
+    template <class Interface>
+    class NullDeviceChild : public Interface
+    {
+    public:
+        virtual ~NullDeviceChild() {}
+
+        HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** object) override {
+            if (riid == __uuidof(IUnknown) || riid == __uuidof(ID3D11DeviceChild) || riid == __uuidof(Interface)) {
+                AddRef();
+                *object = static_cast<Interface*>(this);
+                return S_OK;
+            }
+            *object = nullptr;
+            return E_NOINTERFACE;
+        }
+        ULONG STDMETHODCALLTYPE AddRef() override {
+            return ++m_refs;
+        }
+        ULONG STDMETHODCALLTYPE Release() override {
+            ULONG refs = --m_refs;
+            if (refs == 0) {
+                delete this;
+            }
+            return refs;
+        }
+
+        void STDMETHODCALLTYPE GetDevice(ID3D11Device** device) override {
+            *device = nullptr;
+        }
+        HRESULT STDMETHODCALLTYPE GetPrivateData(REFGUID guid, UINT* dataSize, void* data) override {
+            return DXGI_ERROR_NOT_FOUND;
+        }
+        HRESULT STDMETHODCALLTYPE SetPrivateData(REFGUID guid, UINT dataSize, const void* data) override {
+            return E_NOTIMPL;
+        }
+        HRESULT STDMETHODCALLTYPE SetPrivateDataInterface(REFGUID guid, const IUnknown* data) override {
+            return E_NOTIMPL;
+        }
+
+    private:
+        std::atomic<ULONG> m_refs{ 1 };
+    };
+
+    class NullTexture2D : public NullDeviceChild<ID3D11Texture2D>
+    {
+    public:
+        explicit NullTexture2D(const D3D11_TEXTURE2D_DESC& desc) : m_desc(desc) {}
+
+        void STDMETHODCALLTYPE GetType(D3D11_RESOURCE_DIMENSION* dimension) override {
+            *dimension = D3D11_RESOURCE_DIMENSION_TEXTURE2D;
+        }
+        void STDMETHODCALLTYPE SetEvictionPriority(UINT priority) override {}
+        UINT STDMETHODCALLTYPE GetEvictionPriority() override {
+            return 0;
+        }
+        void STDMETHODCALLTYPE GetDesc(D3D11_TEXTURE2D_DESC* desc) override {
+            *desc = m_desc;
+        }
+
+    private:
+        D3D11_TEXTURE2D_DESC m_desc;
+    };
+
+    // References its resource like a D3D11 view. The resource can be a texture
+    // of a Spout receiver, which has its own device with the null backend.
+    class NullShaderResourceView : public NullDeviceChild<ID3D11ShaderResourceView>
+    {
+    public:
+        NullShaderResourceView(ID3D11Resource* resource, const D3D11_SHADER_RESOURCE_VIEW_DESC& desc) :
+            m_resource(resource), m_desc(desc) {}
+
+        void STDMETHODCALLTYPE GetResource(ID3D11Resource** resource) override {
+            m_resource.CopyTo(resource);
+        }
+        void STDMETHODCALLTYPE GetDesc(D3D11_SHADER_RESOURCE_VIEW_DESC* desc) override {
+            *desc = m_desc;
+        }
+
+    private:
+        ComPtr<ID3D11Resource> m_resource;
+        D3D11_SHADER_RESOURCE_VIEW_DESC m_desc;
+    };
+
+    class NullSamplerState : public NullDeviceChild<ID3D11SamplerState>
+    {
+    public:
+        explicit NullSamplerState(const D3D11_SAMPLER_DESC& desc) : m_desc(desc) {}
+
+        void STDMETHODCALLTYPE GetDesc(D3D11_SAMPLER_DESC* desc) override {
+            *desc = m_desc;
+        }
+
+    private:
+        D3D11_SAMPLER_DESC m_desc;
+    };
+
+}
+
+HRESULT
+SpoutStereoGraphicsNull::CreateTexture(const D3D11_TEXTURE2D_DESC& desc, const D3D11_SUBRESOURCE_DATA* data, ID3D11Texture2D** texture)
+{
+    m_counters.texturesCreated++;
+    *texture = new NullTexture2D(desc);
+    return S_OK;
+}
+
+HRESULT
+SpoutStereoGraphicsNull::CreateShaderResourceView(ID3D11Resource* resource, const D3D11_SHADER_RESOURCE_VIEW_DESC* desc, ID3D11ShaderResourceView** view)
+{
+    m_counters.viewsCreated++;
+
+    // Without a description, the view is of the whole 2D texture in its format
+    D3D11_SHADER_RESOURCE_VIEW_DESC viewDesc = {};
+    if (desc != nullptr) {
+        viewDesc = *desc;
+    }
+    else {
+        ComPtr<ID3D11Texture2D> texture;
+        if (resource == nullptr || FAILED(resource->QueryInterface(IID_PPV_ARGS(&texture)))) {
+            *view = nullptr;
+            return E_INVALIDARG;
+        }
+        D3D11_TEXTURE2D_DESC textureDesc;
+        texture->GetDesc(&textureDesc);
+        viewDesc.Format = textureDesc.Format;
+        viewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+        viewDesc.Texture2D.MipLevels = textureDesc.MipLevels;
+    }
+    *view = new NullShaderResourceView(resource, viewDesc);
+    return S_OK;
+}
+
+HRESULT
+SpoutStereoGraphicsNull::CreateSamplerState(const D3D11_SAMPLER_DESC& desc, ID3D11SamplerState** sampler)
+{
+    m_counters.samplersCreated++;
+    *sampler = new NullSamplerState(desc);
+    return S_OK;
+}
+
+void
+SpoutStereoGraphicsNull::SetViewport(const D3D11_VIEWPORT& viewport)
+{
+    if (changeViewport(viewport)) {
+        m_counters.viewportsSet++;
+    }
+}
+
+void
+SpoutStereoGraphicsNull::SetRenderTarget(ID3D11RenderTargetView* renderTargetView)
+{
+    if (changeRenderTarget(renderTargetView)) {
+        m_counters.renderTargetsSet++;
+    }
+}
+
+void
+SpoutStereoGraphicsNull::ClearRenderTarget(ID3D11RenderTargetView* renderTargetView, const float color[4])
+{
+    m_counters.clears++;
+}
+
+void
+SpoutStereoGraphicsNull::DrawFullscreenQuad(ID3D11ShaderResourceView* textureView, ID3D11SamplerState* sampler)
+{
+    m_counters.quadsDrawn++;
+    changePipeline(SpoutStereoGraphicsPipeline::Quad, 3);
+    changeSampler(sampler);
+    changeTextureView(textureView);
+}
+
+void
+SpoutStereoGraphicsNull::CopyToArraySlice(ID3D11Texture2D* textureArray, UINT slice, ID3D11Resource* source)
+{
+    m_counters.arraySlicesCopied++;
+}
+
+void
+SpoutStereoGraphicsNull::DrawInstancedQuads(ID3D11ShaderResourceView* textureArrayView, ID3D11SamplerState* sampler,
+                                            const SpoutStereoQuadInstance* instances, UINT count)
+{
+    m_counters.instancedDraws++;
+    m_counters.instancedQuads += count;
+    // The viewport covers the render target, whose size is not known, but is the same each time
+    SetViewport(CD3D11_VIEWPORT(0.0f, 0.0f, 0.0f, 0.0f));
+    changePipeline(SpoutStereoGraphicsPipeline::InstancedQuads, 4);
+    changeSampler(sampler);
+    changeTextureView(textureArrayView);
+}
+
+HRESULT
+SpoutStereoGraphicsNull::Present(IDXGISwapChain* swapChain, UINT syncInterval)
+{
+    m_counters.presents++;
+    m_state.renderTargetBound = false;
+    return S_OK;
+}
@@ -0,0 +1,299 @@
+#pragma once
+
+#include "pch.h"
+
+#include "SpoutDX/SpoutCopy.h"
+#include "SpoutStereoWorkerPool.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Counts of the graphics operations issued by the window and tiles.
+// Atomic because tiles create views from the tile update threads.
+struct SpoutStereoGraphicsCounters
+{
+    std::atomic<uint64_t> texturesCreated{ 0 };
+    std::atomic<uint64_t> viewsCreated{ 0 };
+    std::atomic<uint64_t> samplersCreated{ 0 };
+    std::atomic<uint64_t> viewportsSet{ 0 };
+    std::atomic<uint64_t> renderTargetsSet{ 0 };
+    std::atomic<uint64_t> clears{ 0 };
+    std::atomic<uint64_t> quadsDrawn{ 0 };
+    std::atomic<uint64_t> presents{ 0 };
+    std::atomic<uint64_t> stateSets{ 0 };       // Topology, shader, sampler and texture binds for quads
+    std::atomic<uint64_t> stateSetsElided{ 0 }; // Viewport, render target and quad binds skipped as already bound
+    std::atomic<uint64_t> instancedDraws{ 0 };
+    std::atomic<uint64_t> instancedQuads{ 0 };
+    std::atomic<uint64_t> arraySlicesCopied{ 0 };
+
+    void Reset() {
+        texturesCreated = 0;
+        viewsCreated = 0;
+        samplersCreated = 0;
+        viewportsSet = 0;
+        renderTargetsSet = 0;
+        clears = 0;
+        quadsDrawn = 0;
+        presents = 0;
+        stateSets = 0;
+        stateSetsElided = 0;
+        instancedDraws = 0;
+        instancedQuads = 0;
+        arraySlicesCopied = 0;
+    }
+};
+
+// The most quads in one DrawInstancedQuads, the size of the instanced vertex shader's constant buffer
+static const UINT SpoutStereoMaxQuadInstances = 256;
+
+// One quad of an instanced draw, a slice of the texture array drawn into a viewport of the render target
+struct SpoutStereoQuadInstance
+{
+    D3D11_VIEWPORT viewport;
+    UINT slice;
+};
+
+enum class SpoutStereoGraphicsPipeline
+{
+    None,
+    Quad,           // DrawFullscreenQuad
+    InstancedQuads  // DrawInstancedQuads
+};
+
+// What a backend has bound on the device context. Each tile draws with the same
+// shaders and sampler, so most of what it sets is already bound by the previous tile.
+struct SpoutStereoGraphicsState
+{
+    bool viewportBound = false;
+    D3D11_VIEWPORT viewport = {};
+    bool renderTargetBound = false;
+    ID3D11RenderTargetView* renderTargetView = nullptr;
+    SpoutStereoGraphicsPipeline pipeline = SpoutStereoGraphicsPipeline::None; // Topology, shaders and constant buffers
+    bool samplerBound = false;
+    ID3D11SamplerState* sampler = nullptr;
+    bool textureViewBound = false;
+    ID3D11ShaderResourceView* textureView = nullptr;
+};
+
+// The graphics operations the server uses to composite the tiles, so that the
+// frame loop can run on D3D11 or, for benchmarks, without a GPU.
+//
+// Resources are D3D11 interfaces because they are shared with the Spout receivers.
+class SpoutStereoGraphics
+{
+public:
+    virtual ~SpoutStereoGraphics() {}
+
+    // Creates the backend named by GRAPHICS_BACKEND, "d3d11", "software" or "null"
+    static std::unique_ptr<SpoutStereoGraphics> Create(const std::string& backend,
+                                                       Microsoft::WRL::ComPtr<ID3D11Device> d3dDevice,
+                                                       Microsoft::WRL::ComPtr<ID3D11DeviceContext> d3dContext);
+
+    virtual HRESULT CreateTexture(const D3D11_TEXTURE2D_DESC& desc, const D3D11_SUBRESOURCE_DATA* data, ID3D11Texture2D** texture) = 0;
+    virtual HRESULT CreateShaderResourceView(ID3D11Resource* resource, const D3D11_SHADER_RESOURCE_VIEW_DESC* desc, ID3D11ShaderResourceView** view) = 0;
+    virtual HRESULT CreateSamplerState(const D3D11_SAMPLER_DESC& desc, ID3D11SamplerState** sampler) = 0;
+
+    virtual void SetViewport(const D3D11_VIEWPORT& viewport) = 0;
+    virtual void SetRenderTarget(ID3D11RenderTargetView* renderTargetView) = 0;
+    virtual void ClearRenderTarget(ID3D11RenderTargetView* renderTargetView, const float color[4]) = 0;
+
+    // Draws the texture over the whole viewport
+    virtual void DrawFullscreenQuad(ID3D11ShaderResourceView* textureView, ID3D11SamplerState* sampler) = 0;
+
+    // Instanced composition, false if the backend only draws one quad at a time
+    virtual bool supportsInstancedQuads() const {
+        return false;
+    }
+
+    // Copies a texture into one slice of a texture array of the same size and format
+    virtual void CopyToArraySlice(ID3D11Texture2D* textureArray, UINT slice, ID3D11Resource* source) {}
+
+    // Draws each instance's slice of the texture array into its viewport with one draw call.
+    // Sets the viewport to the whole render target, which must have been set.
+    virtual void DrawInstancedQuads(ID3D11ShaderResourceView* textureArrayView, ID3D11SamplerState* sampler,
+                                    const SpoutStereoQuadInstance* instances, UINT count) {}
+
+    virtual HRESULT Present(IDXGISwapChain* swapChain, UINT syncInterval) = 0;
+
+    // Called before the render target views are released, e.g. when the window is resized
+    virtual void ReleaseRenderTargets() {}
+
+    // Forgets what is bound, so that everything is set again. Call after anything
+    // else changes the context's state, e.g. SpriteBatch.
+    void InvalidateState() {
+        m_state = SpoutStereoGraphicsState();
+    }
+
+    // There is no device, so nothing is drawn and created resources are stand-ins
+    virtual bool headless() const = 0;
+
+    const SpoutStereoGraphicsCounters& counters() const {
+        return m_counters;
+    }
+
+    void resetCounters() {
+        m_counters.Reset();
+    }
+
+protected:
+    // Each returns true if the state has to be set, and records it as bound.
+    // Pointers are safe to compare because the context references what is bound.
+    bool changeViewport(const D3D11_VIEWPORT& viewport);
+    bool changeRenderTarget(ID3D11RenderTargetView* renderTargetView);
+    bool changePipeline(SpoutStereoGraphicsPipeline pipeline, int calls);
+    bool changeSampler(ID3D11SamplerState* sampler);
+    bool changeTextureView(ID3D11ShaderResourceView* textureView);
+
+    SpoutStereoGraphicsCounters m_counters;
+    SpoutStereoGraphicsState m_state;
+};
+
+// Draws with the D3D11 device and context created by Game
+class SpoutStereoGraphicsD3D11 : public SpoutStereoGraphics
+{
+public:
+    SpoutStereoGraphicsD3D11(Microsoft::WRL::ComPtr<ID3D11Device> d3dDevice,
+                             Microsoft::WRL::ComPtr<ID3D11DeviceContext> d3dContext);
+    virtual ~SpoutStereoGraphicsD3D11();
+
+    HRESULT CreateTexture(const D3D11_TEXTURE2D_DESC& desc, const D3D11_SUBRESOURCE_DATA* data, ID3D11Texture2D** texture) override;
+    HRESULT CreateShaderResourceView(ID3D11Resource* resource, const D3D11_SHADER_RESOURCE_VIEW_DESC* desc, ID3D11ShaderResourceView** view) override;
+    HRESULT CreateSamplerState(const D3D11_SAMPLER_DESC& desc, ID3D11SamplerState** sampler) override;
+
+    void SetViewport(const D3D11_VIEWPORT& viewport) override;
+    void SetRenderTarget(ID3D11RenderTargetView* renderTargetView) override;
+    void ClearRenderTarget(ID3D11RenderTargetView* renderTargetView, const float color[4]) override;
+
+    void DrawFullscreenQuad(ID3D11ShaderResourceView* textureView, ID3D11SamplerState* sampler) override;
+
+    bool supportsInstancedQuads() const override {
+        return true;
+    }
+    void CopyToArraySlice(ID3D11Texture2D* textureArray, UINT slice, ID3D11Resource* source) override;
+    void DrawInstancedQuads(ID3D11ShaderResourceView* textureArrayView, ID3D11SamplerState* sampler,
+                            const SpoutStereoQuadInstance* instances, UINT count) override;
+
+    HRESULT Present(IDXGISwapChain* swapChain, UINT syncInterval) override;
+
+    bool headless() const override {
+        return false;
+    }
+
+private:
+    Microsoft::WRL::ComPtr<ID3D11Device> m_d3dDevice;
+    Microsoft::WRL::ComPtr<ID3D11DeviceContext> m_d3dContext;
+
+    // Simple shaders for the fullscreen quad
+    Microsoft::WRL::ComPtr<ID3D11VertexShader> m_fullscreenVertexShader;
+    Microsoft::WRL::ComPtr<ID3D11PixelShader> m_fullscreenPixelShader;
+
+    // Instanced quads, with the instances' rectangles and slices in a constant buffer
+    Microsoft::WRL::ComPtr<ID3D11VertexShader> m_instancedVertexShader;
+    Microsoft::WRL::ComPtr<ID3D11PixelShader> m_instancedPixelShader;
+    Microsoft::WRL::ComPtr<ID3D11Buffer> m_instanceBuffer;
+
+    // Size of the render target last set, to place the instances
+    UINT m_targetWidth;
+    UINT m_targetHeight;
+};
+
+// Composites the tiles on the CPU into a framebuffer for each render target, which
+// is copied to the back buffer on Present. A reference for what the D3D11 backend
+// should show, and a baseline for systems without a capable GPU.
+//
+// Textures are still D3D11 resources, as the Spout receivers need them. Each
+// quad's texture is read back through a staging texture and resampled into the
+// viewport by spoutCopy, in bands of rows spread over SOFTWARE_COMPOSITOR_THREADS.
+// 8 bit RGBA and BGRA textures are supported and sRGB formats are copied as stored.
+// Text drawn by SpriteBatch goes directly to the back buffer and is overwritten.
+// Quads are not instanced, so COMPOSITION_MODE = instanced draws per tile.
+class SpoutStereoGraphicsSoftware : public SpoutStereoGraphics
+{
+public:
+    SpoutStereoGraphicsSoftware(Microsoft::WRL::ComPtr<ID3D11Device> d3dDevice,
+                                Microsoft::WRL::ComPtr<ID3D11DeviceContext> d3dContext,
+                                int threads);
+    virtual ~SpoutStereoGraphicsSoftware();
+
+    HRESULT CreateTexture(const D3D11_TEXTURE2D_DESC& desc, const D3D11_SUBRESOURCE_DATA* data, ID3D11Texture2D** texture) override;
+    HRESULT CreateShaderResourceView(ID3D11Resource* resource, const D3D11_SHADER_RESOURCE_VIEW_DESC* desc, ID3D11ShaderResourceView** view) override;
+    HRESULT CreateSamplerState(const D3D11_SAMPLER_DESC& desc, ID3D11SamplerState** sampler) override;
+
+    void SetViewport(const D3D11_VIEWPORT& viewport) override;
+    void SetRenderTarget(ID3D11RenderTargetView* renderTargetView) override;
+    void ClearRenderTarget(ID3D11RenderTargetView* renderTargetView, const float color[4]) override;
+
+    void DrawFullscreenQuad(ID3D11ShaderResourceView* textureView, ID3D11SamplerState* sampler) override;
+
+    HRESULT Present(IDXGISwapChain* swapChain, UINT syncInterval) override;
+
+    void ReleaseRenderTargets() override;
+
+    bool headless() const override {
+        return false;
+    }
+
+    // The composited B8G8R8A8 pixels for a render target, null if nothing has been drawn to it
+    const std::vector<uint32_t>* framebuffer(ID3D11RenderTargetView* renderTargetView);
+
+private:
+    // CPU copy of one render target, which is not referenced so that the swap chain can be resized
+    struct Framebuffer {
+        ID3D11RenderTargetView* renderTargetView;
+        UINT subresource;
+        UINT width;
+        UINT height;
+        std::vector<uint32_t> pixels;
+    };
+
+    Framebuffer* findFramebuffer(ID3D11RenderTargetView* renderTargetView, bool create);
+
+    Microsoft::WRL::ComPtr<ID3D11Device> m_d3dDevice;
+    Microsoft::WRL::ComPtr<ID3D11DeviceContext> m_d3dContext;
+
+    std::vector<std::unique_ptr<Framebuffer>> m_framebuffers;
+    Framebuffer* m_target;
+    D3D11_VIEWPORT m_viewport;
+
+    // Readback of the texture being drawn, recreated when the size or format changes
+    Microsoft::WRL::ComPtr<ID3D11Texture2D> m_staging;
+    D3D11_TEXTURE2D_DESC m_stagingDesc;
+    bool m_warnedFormat;
+
+    spoutCopy m_copy;
+    SpoutStereoWorkerPool m_workers;
+};
+
+// Counts the calls and does nothing else, for running the frame loop without a GPU.
+// Tracks the bound state like the D3D11 backend, so the counts match what it would set.
+// Creates stand-in textures, views and samplers that are only reference counted, so
+// that the tiles and composition take the same paths as with D3D11.
+class SpoutStereoGraphicsNull : public SpoutStereoGraphics
+{
+public:
+    HRESULT CreateTexture(const D3D11_TEXTURE2D_DESC& desc, const D3D11_SUBRESOURCE_DATA* data, ID3D11Texture2D** texture) override;
+    HRESULT CreateShaderResourceView(ID3D11Resource* resource, const D3D11_SHADER_RESOURCE_VIEW_DESC* desc, ID3D11ShaderResourceView** view) override;
+    HRESULT CreateSamplerState(const D3D11_SAMPLER_DESC& desc, ID3D11SamplerState** sampler) override;
+
+    void SetViewport(const D3D11_VIEWPORT& viewport) override;
+    void SetRenderTarget(ID3D11RenderTargetView* renderTargetView) override;
+    void ClearRenderTarget(ID3D11RenderTargetView* renderTargetView, const float color[4]) override;
+
+    void DrawFullscreenQuad(ID3D11ShaderResourceView* textureView, ID3D11SamplerState* sampler) override;
+
+    bool supportsInstancedQuads() const override {
+        return true;
+    }
+    void CopyToArraySlice(ID3D11Texture2D* textureArray, UINT slice, ID3D11Resource* source) override;
+    void DrawInstancedQuads(ID3D11ShaderResourceView* textureArrayView, ID3D11SamplerState* sampler,
+                            const SpoutStereoQuadInstance* instances, UINT count) override;
+
+    HRESULT Present(IDXGISwapChain* swapChain, UINT syncInterval) override;
+
+    bool headless() const override {
+        return true;
+    }
+};
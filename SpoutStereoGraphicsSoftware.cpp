@@ -0,0 +1,249 @@
+#include "pch.h"
+#include "SpoutStereoGraphics.h"
+
+#include <iostream>
+
+using Microsoft::WRL::ComPtr;
+
+// Fewer rows than this in a band cost more in waking the workers than they save
+static const UINT MinBandRows = 16;
+
+
+SpoutStereoGraphicsSoftware::SpoutStereoGraphicsSoftware(ComPtr<ID3D11Device> d3dDevice, ComPtr<ID3D11DeviceContext> d3dContext, int threads) :
+    m_d3dDevice(d3dDevice),
+    m_d3dContext(d3dContext),
+    m_target(nullptr),
+    m_viewport(),
+    m_stagingDesc(),
+    m_warnedFormat(false)
+{
+    m_workers.Start(threads);
+}
+
+SpoutStereoGraphicsSoftware::~SpoutStereoGraphicsSoftware()
+{
+    m_workers.Stop();
+}
+
+HRESULT
+SpoutStereoGraphicsSoftware::CreateTexture(const D3D11_TEXTURE2D_DESC& desc, const D3D11_SUBRESOURCE_DATA* data, ID3D11Texture2D** texture)
+{
+    m_counters.texturesCreated++;
+    return m_d3dDevice->CreateTexture2D(&desc, data, texture);
+}
+
+HRESULT
+SpoutStereoGraphicsSoftware::CreateShaderResourceView(ID3D11Resource* resource, const D3D11_SHADER_RESOURCE_VIEW_DESC* desc, ID3D11ShaderResourceView** view)
+{
+    m_counters.viewsCreated++;
+    return m_d3dDevice->CreateShaderResourceView(resource, desc, view);
+}
+
+HRESULT
+SpoutStereoGraphicsSoftware::CreateSamplerState(const D3D11_SAMPLER_DESC& desc, ID3D11SamplerState** sampler)
+{
+    // Created for the tiles, but quads are always point sampled
+    m_counters.samplersCreated++;
+    return m_d3dDevice->CreateSamplerState(&desc, sampler);
+}
+
+void
+SpoutStereoGraphicsSoftware::SetViewport(const D3D11_VIEWPORT& viewport)
+{
+    if (!changeViewport(viewport)) {
+        return;
+    }
+    m_counters.viewportsSet++;
+    m_viewport = viewport;
+}
+
+void
+SpoutStereoGraphicsSoftware::SetRenderTarget(ID3D11RenderTargetView* renderTargetView)
+{
+    if (!changeRenderTarget(renderTargetView)) {
+        return;
+    }
+    m_counters.renderTargetsSet++;
+    m_target = findFramebuffer(renderTargetView, true);
+}
+
+void
+SpoutStereoGraphicsSoftware::ClearRenderTarget(ID3D11RenderTargetView* renderTargetView, const float color[4])
+{
+    m_counters.clears++;
+    Framebuffer* framebuffer = findFramebuffer(renderTargetView, true);
+    if (framebuffer == nullptr) {
+        return;
+    }
+    auto channel = [color](int i) {
+        float value = (std::min)((std::max)(color[i], 0.0f), 1.0f);
+        return (uint32_t)(value * 255.0f + 0.5f);
+    };
+    uint32_t pixel = (channel(3) << 24) | (channel(0) << 16) | (channel(1) << 8) | channel(2);
+    std::fill(framebuffer->pixels.begin(), framebuffer->pixels.end(), pixel);
+}
+
+void
+SpoutStereoGraphicsSoftware::DrawFullscreenQuad(ID3D11ShaderResourceView* textureView, ID3D11SamplerState* sampler)
+{
+    m_counters.quadsDrawn++;
+    if (m_target == nullptr || textureView == nullptr) {
+        return;
+    }
+
+    ComPtr<ID3D11Resource> resource;
+    textureView->GetResource(&resource);
+    ComPtr<ID3D11Texture2D> texture;
+    if (FAILED(resource.As(&texture))) {
+        return;
+    }
+    D3D11_TEXTURE2D_DESC desc;
+    texture->GetDesc(&desc);
+
+    // The framebuffer has the back buffer's B8G8R8A8 layout
+    bool swapRB;
+    switch (desc.Format) {
+    case DXGI_FORMAT_B8G8R8A8_UNORM:
+    case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+    case DXGI_FORMAT_B8G8R8X8_UNORM:
+    case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+        swapRB = false;
+        break;
+    case DXGI_FORMAT_R8G8B8A8_UNORM:
+    case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+        swapRB = true;
+        break;
+    default:
+        if (!m_warnedFormat) {
+            std::cout << "Warning: The software compositor does not support texture format " << desc.Format << std::endl;
+            m_warnedFormat = true;
+        }
+        return;
+    }
+
+    // Clip the viewport to the framebuffer. The texture is still scaled to the
+    // whole viewport, so a tile that extends past the edge is cropped as with D3D11.
+    int viewportX = (int)m_viewport.TopLeftX;
+    int viewportY = (int)m_viewport.TopLeftY;
+    int viewportWidth = (int)m_viewport.Width;
+    int viewportHeight = (int)m_viewport.Height;
+    int left = (std::max)(viewportX, 0);
+    int top = (std::max)(viewportY, 0);
+    int right = (std::min)(viewportX + viewportWidth, (int)m_target->width);
+    int bottom = (std::min)(viewportY + viewportHeight, (int)m_target->height);
+    if (right <= left || bottom <= top) {
+        return;
+    }
+    UINT width = (UINT)(right - left);
+    UINT height = (UINT)(bottom - top);
+    UINT cropLeft = (UINT)(left - viewportX);
+    UINT cropTop = (UINT)(top - viewportY);
+
+    if (!m_staging || m_stagingDesc.Width != desc.Width || m_stagingDesc.Height != desc.Height || m_stagingDesc.Format != desc.Format) {
+        m_staging.Reset();
+        D3D11_TEXTURE2D_DESC stagingDesc = {};
+        stagingDesc.Width = desc.Width;
+        stagingDesc.Height = desc.Height;
+        stagingDesc.MipLevels = 1;
+        stagingDesc.ArraySize = 1;
+        stagingDesc.Format = desc.Format;
+        stagingDesc.SampleDesc.Count = 1;
+        stagingDesc.Usage = D3D11_USAGE_STAGING;
+        stagingDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+        if (FAILED(m_d3dDevice->CreateTexture2D(&stagingDesc, nullptr, &m_staging))) {
+            return;
+        }
+        m_stagingDesc = stagingDesc;
+    }
+    m_d3dContext->CopySubresourceRegion(m_staging.Get(), 0, 0, 0, 0, texture.Get(), 0, nullptr);
+
+    D3D11_MAPPED_SUBRESOURCE mapped = {};
+    if (FAILED(m_d3dContext->Map(m_staging.Get(), 0, D3D11_MAP_READ, 0, &mapped))) {
+        return;
+    }
+
+    // Split the viewport into a band of rows for each thread
+    UINT framebufferPitch = m_target->width * 4;
+    unsigned char* destination = (unsigned char*)(m_target->pixels.data() + (size_t)top * m_target->width + left);
+    UINT bands = (std::min)((UINT)m_workers.threads() + 1, (height + MinBandRows - 1) / MinBandRows);
+    UINT bandRows = (height + bands - 1) / bands;
+    m_workers.Run((int)bands, [&](int band) {
+        UINT firstRow = (UINT)band * bandRows;
+        if (firstRow >= height) {
+            return;
+        }
+        UINT rows = (std::min)(bandRows, height - firstRow);
+        m_copy.rgba2rgbaResample(mapped.pData, destination, desc.Width, desc.Height, mapped.RowPitch,
+            (UINT)viewportWidth, (UINT)viewportHeight, framebufferPitch,
+            cropLeft, cropTop, width, cropTop + firstRow, rows, swapRB);
+    });
+
+    m_d3dContext->Unmap(m_staging.Get(), 0);
+}
+
+HRESULT
+SpoutStereoGraphicsSoftware::Present(IDXGISwapChain* swapChain, UINT syncInterval)
+{
+    m_counters.presents++;
+    for (auto framebuffer = m_framebuffers.begin(); framebuffer != m_framebuffers.end(); framebuffer++) {
+        ComPtr<ID3D11Resource> backBuffer;
+        (*framebuffer)->renderTargetView->GetResource(&backBuffer);
+        m_d3dContext->UpdateSubresource(backBuffer.Get(), (*framebuffer)->subresource, nullptr,
+            (*framebuffer)->pixels.data(), (*framebuffer)->width * 4, 0);
+    }
+    return swapChain->Present(syncInterval, 0);
+}
+
+void
+SpoutStereoGraphicsSoftware::ReleaseRenderTargets()
+{
+    m_target = nullptr;
+    m_framebuffers.clear();
+}
+
+const std::vector<uint32_t>*
+SpoutStereoGraphicsSoftware::framebuffer(ID3D11RenderTargetView* renderTargetView)
+{
+    Framebuffer* framebuffer = findFramebuffer(renderTargetView, false);
+    return framebuffer ? &framebuffer->pixels : nullptr;
+}
+
+SpoutStereoGraphicsSoftware::Framebuffer*
+SpoutStereoGraphicsSoftware::findFramebuffer(ID3D11RenderTargetView* renderTargetView, bool create)
+{
+    if (renderTargetView == nullptr) {
+        return nullptr;
+    }
+    for (auto framebuffer = m_framebuffers.begin(); framebuffer != m_framebuffers.end(); framebuffer++) {
+        if ((*framebuffer)->renderTargetView == renderTargetView) {
+            return framebuffer->get();
+        }
+    }
+    if (!create) {
+        return nullptr;
+    }
+
+    // The framebuffer matches the view's slice of the back buffer
+    ComPtr<ID3D11Resource> resource;
+    renderTargetView->GetResource(&resource);
+    ComPtr<ID3D11Texture2D> texture;
+    if (FAILED(resource.As(&texture))) {
+        return nullptr;
+    }
+    D3D11_TEXTURE2D_DESC desc;
+    texture->GetDesc(&desc);
+    D3D11_RENDER_TARGET_VIEW_DESC viewDesc;
+    renderTargetView->GetDesc(&viewDesc);
+
+    std::unique_ptr<Framebuffer> framebuffer(new Framebuffer());
+    framebuffer->renderTargetView = renderTargetView;
+    framebuffer->subresource = 0;
+    if (viewDesc.ViewDimension == D3D11_RTV_DIMENSION_TEXTURE2DARRAY) {
+        framebuffer->subresource = D3D11CalcSubresource(viewDesc.Texture2DArray.MipSlice, viewDesc.Texture2DArray.FirstArraySlice, desc.MipLevels);
+    }
+    framebuffer->width = desc.Width;
+    framebuffer->height = desc.Height;
+    framebuffer->pixels.assign((size_t)desc.Width * desc.Height, 0);
+    m_framebuffers.push_back(std::move(framebuffer));
+    return m_framebuffers.back().get();
+}
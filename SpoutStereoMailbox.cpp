@@ -0,0 +1,53 @@
+#include "pch.h"
+#include "SpoutStereoMailbox.h"
+
+
+SpoutStereoFrameMailbox::SpoutStereoFrameMailbox() :
+    m_back(0),
+    m_front(2),
+    m_middle(1)
+{
+}
+
+SpoutStereoFrameMailbox::~SpoutStereoFrameMailbox()
+{
+    Reset();
+}
+
+void
+SpoutStereoFrameMailbox::Publish()
+{
+    // The frame that was in the middle, consumed or not, is filled next
+    m_back = m_middle.exchange(m_back | Fresh) & ~Fresh;
+}
+
+bool
+SpoutStereoFrameMailbox::Consume()
+{
+    if ((m_middle.load() & Fresh) == 0) {
+        return false;
+    }
+    m_front = m_middle.exchange(m_front) & ~Fresh;
+    return true;
+}
+
+void
+SpoutStereoFrameMailbox::Reset()
+{
+    auto release = [](auto*& resource) {
+        if (resource != nullptr) {
+            resource->Release();
+            resource = nullptr;
+        }
+    };
+    for (int i = 0; i < 3; i++) {
+        release(m_frames[i].left.texture);
+        release(m_frames[i].left.view);
+        release(m_frames[i].right.texture);
+        release(m_frames[i].right.view);
+        m_frames[i] = SpoutStereoTileFrame();
+    }
+    m_back = 0;
+    m_front = 2;
+    m_middle = 1;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "pch.h"
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// One eye of a tile as received, in a texture owned by the mailbox
+struct SpoutStereoEyeFrame
+{
+    ID3D11Texture2D* texture = nullptr;
+    ID3D11ShaderResourceView* view = nullptr;
+    // False if the eye is not receiving, the texture is kept for the next frame
+    bool valid = false;
+    long senderFrame = 0;
+    // Time the frame was received, 0 if it was published before
+    uint64_t receiveTime = 0;
+};
+
+struct SpoutStereoTileFrame
+{
+    SpoutStereoEyeFrame left;
+    SpoutStereoEyeFrame right;
+    bool receiving = false;
+    // Shown in the labels while an eye is not receiving, as sender patterns are bound on the receive thread
+    std::string senderNameLeft;
+    std::string senderNameRight;
+};
+
+// Hands a tile's newest frame from the receive thread to the render thread
+// without locking. Of three frames, the receive thread fills one and the
+// render thread draws another, and the third is the newest published frame,
+// which the two exchange atomically. Both eyes are published together so that
+// a stereo pair is never split.
+class SpoutStereoFrameMailbox
+{
+public:
+    SpoutStereoFrameMailbox();
+    virtual ~SpoutStereoFrameMailbox();
+
+    // Receive thread: the frame to fill, then Publish makes it the newest
+    SpoutStereoTileFrame& back() {
+        return m_frames[m_back];
+    }
+    void Publish();
+
+    // Render thread: takes the newest frame, returns false if none was published since the last call
+    bool Consume();
+    const SpoutStereoTileFrame& front() const {
+        return m_frames[m_front];
+    }
+
+    // Releases the textures and empties the mailbox, while neither thread is using it
+    void Reset();
+
+protected:
+    // Set in m_middle while the frame there has not been consumed
+    static const int Fresh = 4;
+
+    SpoutStereoTileFrame m_frames[3];
+    int m_back;
+    int m_front;
+    std::atomic<int> m_middle;
+};
@@ -1,6 +1,9 @@
 #include "pch.h"
 #include "SpoutStereoTile.h"
 #include "SpoutStereoWindow.h"
+#include "SpoutStereoTrace.h"
+
+#include <thread>
 
 using namespace DirectX;
 using namespace DirectX::SimpleMath;
@@ -11,7 +14,30 @@ SpoutStereoTile::SpoutStereoTile() :
     m_receivingFromSpout(false),
     m_requiresDeviceReset(false),
     m_neverShowDebugGraphics(false),
-    m_showDebugGraphics(true)
+    m_showDebugGraphics(true),
+    m_senderPatternNewest(false),
+    m_senderBoundLeft(true),
+    m_senderBoundRight(true),
+    m_waitGeneration(0),
+    m_skippedReceives(0),
+    m_stereoPairLock(false),
+    m_stereoPairLockTimeoutMs(0),
+    m_stereoPairFrames(0),
+    m_stereoPairWaits(0),
+    m_stereoPairMismatches(0),
+    m_receiveTimeLeft(0),
+    m_receiveTimeRight(0),
+    m_publishPending(true),
+    m_damaged(true),
+    m_drawReceiving(false),
+    m_drawFrameLeft(0),
+    m_drawFrameRight(0),
+    m_drawReceiveTimeLeft(0),
+    m_drawReceiveTimeRight(0),
+    m_lastDrawnFrameLeft(0),
+    m_lastDrawnFrameRight(0),
+    m_duplicatedLeft(0),
+    m_duplicatedRight(0)
 {
 }
 
@@ -37,25 +63,55 @@ SpoutStereoTile::Initialize(const std::string &name, SpoutStereoWindow* parentWi
     // Spout receiver setup
     if (m_parentWindow->stereo()) {
         m_senderNameLeft = ConfigVal::Get(m_name + "SPOUT_SENDER_NAME_LEFT", std::string(m_name + "_LeftEye"));
-        m_receiverLeft.SetReceiverName(m_senderNameLeft.c_str());
-
         m_senderNameRight = ConfigVal::Get(m_name + "SPOUT_SENDER_NAME_RIGHT", std::string(m_name + "_RightEye"));
-        m_receiverRight.SetReceiverName(m_senderNameRight.c_str());
     }
     else if (ConfigVal::Contains(m_name + "SPOUT_SENDER_NAME")) {
         m_senderNameLeft = ConfigVal::Get(m_name + "SPOUT_SENDER_NAME", std::string(m_name));
-        m_receiverLeft.SetReceiverName(m_senderNameLeft.c_str());
     }
     else {
         m_senderNameLeft = ConfigVal::Get(m_name + "SPOUT_SENDER_NAME_LEFT", std::string(m_name + "_LeftEye"));
+    }
+
+    // Optionally bind to senders by pattern, e.g. "LeftWall_*" or "*_RightEye".
+    // The pattern is shown as the sender name until a sender matches, and the
+    // receiver is not given a name, so it does not receive, until then.
+    if (m_parentWindow->stereo()) {
+        m_senderPatternLeft = ConfigVal::Get(m_name + "SPOUT_SENDER_PATTERN_LEFT", std::string());
+        m_senderPatternRight = ConfigVal::Get(m_name + "SPOUT_SENDER_PATTERN_RIGHT", std::string());
+    }
+    else if (ConfigVal::Contains(m_name + "SPOUT_SENDER_PATTERN")) {
+        m_senderPatternLeft = ConfigVal::Get(m_name + "SPOUT_SENDER_PATTERN", std::string());
+    }
+    else {
+        m_senderPatternLeft = ConfigVal::Get(m_name + "SPOUT_SENDER_PATTERN_LEFT", std::string());
+    }
+    if (!m_senderPatternLeft.empty()) {
+        m_senderNameLeft = m_senderPatternLeft;
+    }
+    else {
         m_receiverLeft.SetReceiverName(m_senderNameLeft.c_str());
     }
+    m_senderBoundLeft = m_senderPatternLeft.empty();
+    if (m_parentWindow->stereo()) {
+        if (!m_senderPatternRight.empty()) {
+            m_senderNameRight = m_senderPatternRight;
+        }
+        else {
+            m_receiverRight.SetReceiverName(m_senderNameRight.c_str());
+        }
+    }
+    m_senderBoundRight = m_senderPatternRight.empty();
+    m_senderPatternNewest = (ConfigVal::Get(m_name + "SPOUT_SENDER_PATTERN_MATCH", std::string("first")) == "newest");
 
     // configure the default display when no spout source is detected
     m_spoutLabelX = ConfigVal::Get(m_name + "SPOUT_LABEL_X", 0);
     m_spoutLabelY = ConfigVal::Get(m_name + "SPOUT_LABEL_Y", 0);
 
     m_neverShowDebugGraphics = ConfigVal::Get(m_name + "NEVER_SHOW_DEBUG_GRAPHICS", false);
+
+    // Stereo pair lock, the same for all tiles
+    m_stereoPairLock = ConfigVal::Get("STEREO_PAIR_LOCK", false);
+    m_stereoPairLockTimeoutMs = ConfigVal::Get("STEREO_PAIR_LOCK_TIMEOUT_MS", 4);
 }
 
 void
@@ -124,12 +180,13 @@ SpoutStereoTile::CreateDeviceResources(Microsoft::WRL::ComPtr<ID3D11Device> d3dD
     textureSubresourceDataLeft.pSysMem = texBytesLeft;
     textureSubresourceDataLeft.SysMemPitch = texBytesPerRow;
 
+    SpoutStereoGraphics* graphics = m_parentWindow->graphics();
     DX::ThrowIfFailed(
-        m_d3dDevice->CreateTexture2D(&textureDesc, &textureSubresourceDataLeft, &m_defaultTextureLeft)
+        graphics->CreateTexture(textureDesc, &textureSubresourceDataLeft, &m_defaultTextureLeft)
     );
     if (m_defaultTextureLeft != NULL) {
         DX::ThrowIfFailed(
-            m_d3dDevice->CreateShaderResourceView(m_defaultTextureLeft, nullptr, &m_defaultTextureViewLeft)
+            graphics->CreateShaderResourceView(m_defaultTextureLeft, nullptr, &m_defaultTextureViewLeft)
         );
     }
     delete[] texBytesLeft;
@@ -141,11 +198,11 @@ SpoutStereoTile::CreateDeviceResources(Microsoft::WRL::ComPtr<ID3D11Device> d3dD
         textureSubresourceDataRight.SysMemPitch = texBytesPerRow;
         
         DX::ThrowIfFailed(
-            m_d3dDevice->CreateTexture2D(&textureDesc, &textureSubresourceDataRight, &m_defaultTextureRight)
+            graphics->CreateTexture(textureDesc, &textureSubresourceDataRight, &m_defaultTextureRight)
         );
         if (m_defaultTextureRight != NULL) {
             DX::ThrowIfFailed(
-                m_d3dDevice->CreateShaderResourceView(m_defaultTextureRight, nullptr, &m_defaultTextureViewRight)
+                graphics->CreateShaderResourceView(m_defaultTextureRight, nullptr, &m_defaultTextureViewRight)
             );
         }
         delete[] texBytesRight;
@@ -164,26 +221,44 @@ SpoutStereoTile::CreateDeviceResources(Microsoft::WRL::ComPtr<ID3D11Device> d3dD
     samplerDesc.BorderColor[3] = 1.0f;
     samplerDesc.ComparisonFunc = D3D11_COMPARISON_NEVER;
     DX::ThrowIfFailed(
-        m_d3dDevice->CreateSamplerState(&samplerDesc, &m_samplerState)
+        graphics->CreateSamplerState(samplerDesc, &m_samplerState)
     );
 }
 
 void
 SpoutStereoTile::ReleaseDeviceResources()
 {
+    // Resources are null when they were not created
+    auto release = [](auto*& resource) {
+        if (resource != nullptr) {
+            resource->Release();
+            resource = nullptr;
+        }
+    };
+
     m_receiverLeft.ReleaseReceiver();
-    m_defaultTextureLeft->Release();
-    m_defaultTextureViewLeft->Release();
-    m_receivedTextureLeft->Release();
-    m_receivedTextureViewLeft->Release();
+    release(m_defaultTextureLeft);
+    release(m_defaultTextureViewLeft);
+    release(m_receivedTextureLeft);
+    release(m_receivedTextureViewLeft);
 
     if (m_parentWindow->stereo()) {
         m_receiverRight.ReleaseReceiver();
-        m_defaultTextureRight->Release();
-        m_defaultTextureViewRight->Release();
-        m_receivedTextureRight->Release();
-        m_receivedTextureViewRight->Release();
+        release(m_defaultTextureRight);
+        release(m_defaultTextureViewRight);
+        release(m_receivedTextureRight);
+        release(m_receivedTextureViewRight);
     }
+    m_viewKeyLeft = ViewKey();
+    m_viewKeyRight = ViewKey();
+
+    // The sender names are published again with the first frame
+    m_mailbox.Reset();
+    m_publishPending = true;
+    m_damaged = true;
+    m_drawReceiving = false;
+    m_drawViewLeft = nullptr;
+    m_drawViewRight = nullptr;
 
     m_d3dContext.Reset();
     m_d3dDevice.Reset();
@@ -202,154 +277,537 @@ SpoutStereoTile::ReleaseWindowResources()
 
 
 void
-SpoutStereoTile::Update()
+SpoutStereoTile::GetSenderNames(std::vector<std::string>& names)
 {
-    // --- LEFT TEXTURE SPOUT CONNECTION ---
+    names.push_back(m_senderNameLeft);
+    if (m_parentWindow->stereo()) {
+        names.push_back(m_senderNameRight);
+    }
+}
 
-    bool receivedLeft = false;
-    bool receivedRight = false;
+bool
+SpoutStereoTile::BindSenderPatterns()
+{
+    bool changed = false;
+    // Keep the bound sender while it is connected
+    if (!m_senderPatternLeft.empty() && (m_receivedTextureViewLeft == nullptr)) {
+        changed = bindSenderPattern(m_senderPatternLeft, m_senderNameLeft, m_senderBoundLeft, m_receiverLeft) || changed;
+    }
+    if (m_parentWindow->stereo() && !m_senderPatternRight.empty() && (m_receivedTextureViewRight == nullptr)) {
+        changed = bindSenderPattern(m_senderPatternRight, m_senderNameRight, m_senderBoundRight, m_receiverRight) || changed;
+    }
+    return changed;
+}
+
+bool
+SpoutStereoTile::bindSenderPattern(const std::string& pattern, std::string& senderName, bool& bound, spoutDX& receiver)
+{
+    std::string match;
+    if (!m_parentWindow->findSenderPattern(pattern, m_senderPatternNewest, match) || (bound && match == senderName)) {
+        return false;
+    }
+    std::cout << "Tile " << m_name << " bound sender pattern " << pattern << " to " << match << std::endl;
+    senderName = match;
+    bound = true;
+    receiver.ReleaseReceiver();
+    receiver.SetReceiverName(senderName.c_str());
+    m_publishPending = true;
+    return true;
+}
+
+size_t
+SpoutStereoTile::PresetSenderInfo(const std::vector<SharedTextureInfo>& info, const std::vector<bool>& found, size_t index)
+{
+    if (index < info.size()) {
+        m_receiverLeft.PresetSenderInfo(m_senderNameLeft.c_str(), found[index] ? &info[index] : nullptr);
+    }
+    index++;
+    if (m_parentWindow->stereo()) {
+        if (index < info.size()) {
+            m_receiverRight.PresetSenderInfo(m_senderNameRight.c_str(), found[index] ? &info[index] : nullptr);
+        }
+        index++;
+    }
+    return index;
+}
+
+bool
+SpoutStereoTile::shouldTryReceive()
+{
+    if (m_receivingFromSpout) {
+        return true;
+    }
 
+    // Senders that use the Spout sender registry change the sender list
+    // generation when they start. Others are found by retrying at an interval.
+    uint32_t generation = m_parentWindow->senderListGeneration();
+    auto now = std::chrono::steady_clock::now();
+    if ((generation != 0) && (generation == m_waitGeneration) &&
+        (now - m_lastReceiveAttempt < m_parentWindow->senderRetryInterval())) {
+        return false;
+    }
+    m_waitGeneration = generation;
+    m_lastReceiveAttempt = now;
+    return true;
+}
+
+bool
+SpoutStereoTile::receiveEye(spoutDX& receiver, ID3D11ShaderResourceView*& textureView, ViewKey& viewKey, uint64_t& receiveTime)
+{
     // Receive a new texture
-    if (m_receiverLeft.ReceiveTexture()) {
-        receivedLeft = true;
-        // The D3D11 device within the SpoutDX class could have changed.
-        // If it has switched to use a different sender graphics adapter,
-        // stop receiving the texture and re-initialize the application.
-        if (m_receiverLeft.GetAdapterAuto()) {
-            if (m_d3dDevice.Get() != m_receiverLeft.GetDX11Device()) {
-                m_requiresDeviceReset = true;
-                return;
+    bool received;
+    {
+        SPOUT_TRACE_ZONE("ReceiveTexture");
+        received = receiver.ReceiveTexture();
+    }
+    if (!received) {
+        // A sender was not found or the connected sender closed
+        // Release the texture resource view so render uses the default texture
+        if (textureView != nullptr) {
+            textureView->Release();
+            textureView = nullptr;
+            m_publishPending = true;
+        }
+        viewKey = ViewKey();
+        return false;
+    }
+
+    // The D3D11 device within the SpoutDX class could have changed.
+    // If it has switched to use a different sender graphics adapter,
+    // stop receiving the texture and re-initialize the application.
+    // Without a device (the null graphics backend) the receivers use their own.
+    if (receiver.GetAdapterAuto() && m_d3dDevice) {
+        if (m_d3dDevice.Get() != receiver.GetDX11Device()) {
+            m_requiresDeviceReset = true;
+            return true;
+        }
+    }
+    // If the frame is new, then create/update the shader resource view
+    if (receiver.IsFrameNew()) {
+        // Latency from the sender's publish time, if the sender writes one
+        receiveTime = spoutstats::NowMicroseconds();
+        int64_t publishTime = receiver.GetSenderPublishTime();
+        if (publishTime > 0 && receiveTime >= (uint64_t)publishTime) {
+            m_publishToReceive.Add(receiveTime - (uint64_t)publishTime);
+        }
+        m_publishPending = true;
+
+        // Keep the view while the receiver's texture is the same
+        ViewKey key;
+        key.texture = receiver.GetSenderTexture();
+        key.format = receiver.GetSenderFormat();
+        key.width = receiver.GetSenderWidth();
+        key.height = receiver.GetSenderHeight();
+        if (key == viewKey && textureView != nullptr) {
+            return true;
+        }
+
+        // release old view if it exists
+        if (textureView != nullptr) {
+            textureView->Release();
+            textureView = nullptr;
+        }
+        // create new view
+        D3D11_SHADER_RESOURCE_VIEW_DESC shaderResourceViewDesc;
+        ZeroMemory(&shaderResourceViewDesc, sizeof(shaderResourceViewDesc));
+        // Match format of the sender
+        shaderResourceViewDesc.Format = key.format;
+        shaderResourceViewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+        shaderResourceViewDesc.Texture2D.MostDetailedMip = 0;
+        shaderResourceViewDesc.Texture2D.MipLevels = 1;
+        m_parentWindow->graphics()->CreateShaderResourceView(key.texture, &shaderResourceViewDesc, &textureView);
+        viewKey = key;
+    }
+    return true;
+}
+
+void
+SpoutStereoTile::lockStereoPair()
+{
+    // Frame numbers are zero for senders that do not count frames
+    long frameLeft = m_receiverLeft.GetSenderFrame();
+    long frameRight = m_receiverRight.GetSenderFrame();
+    if (m_receivedTextureViewLeft == nullptr || m_receivedTextureViewRight == nullptr || frameLeft <= 0 || frameRight <= 0) {
+        return;
+    }
+
+    // Hold the newer eye by receiving the other until its frame arrives
+    if (frameLeft != frameRight) {
+        SPOUT_TRACE_ZONE("Stereo pair lock");
+        m_stereoPairWaits++;
+        uint64_t start = spoutstats::NowMicroseconds();
+        uint64_t timeout = (uint64_t)m_stereoPairLockTimeoutMs * 1000;
+        while (frameLeft != frameRight && spoutstats::NowMicroseconds() - start < timeout) {
+            std::this_thread::yield();
+            bool received = (frameLeft < frameRight) ?
+                receiveEye(m_receiverLeft, m_receivedTextureViewLeft, m_viewKeyLeft, m_receiveTimeLeft) :
+                receiveEye(m_receiverRight, m_receivedTextureViewRight, m_viewKeyRight, m_receiveTimeRight);
+            if (!received || m_requiresDeviceReset) {
+                break;
             }
+            frameLeft = m_receiverLeft.GetSenderFrame();
+            frameRight = m_receiverRight.GetSenderFrame();
+        }
+        m_stereoPairWaitTime.Add(spoutstats::NowMicroseconds() - start);
+    }
+}
+
+void
+SpoutStereoTile::Update()
+{
+    // Zones are named by the tile's config prefix
+    SPOUT_TRACE_ZONE(m_name.c_str());
+
+    // Skip the registry lookups while waiting for a sender that is not running
+    if (!shouldTryReceive()) {
+        m_skippedReceives++;
+        return;
+    }
+
+    // --- LEFT TEXTURE SPOUT CONNECTION ---
+    // An eye with a sender pattern waits until the pattern has matched a sender
+    bool receivedLeft = m_senderBoundLeft &&
+        receiveEye(m_receiverLeft, m_receivedTextureViewLeft, m_viewKeyLeft, m_receiveTimeLeft);
+    if (m_requiresDeviceReset) {
+        return;
+    }
+
+    // --- RIGHT TEXTURE SPOUT CONNECTION ---
+    bool receivedRight = false;
+    if (m_parentWindow->stereo()) {
+        receivedRight = m_senderBoundRight &&
+            receiveEye(m_receiverRight, m_receivedTextureViewRight, m_viewKeyRight, m_receiveTimeRight);
+        if (m_requiresDeviceReset) {
+            return;
         }
-        // If the frame is new, then create/update the shader resource view
-        if (m_receiverLeft.IsFrameNew()) {
-            // release old view if it exists
-            if (m_receivedTextureViewLeft != nullptr) {
-                m_receivedTextureViewLeft->Release();
-                m_receivedTextureViewLeft = nullptr;
+        if (m_stereoPairLock) {
+            lockStereoPair();
+            if (m_requiresDeviceReset) {
+                return;
             }
-            // create new view
-            D3D11_SHADER_RESOURCE_VIEW_DESC shaderResourceViewDesc;
-            ZeroMemory(&shaderResourceViewDesc, sizeof(shaderResourceViewDesc));
-            // Match format of the sender
-            shaderResourceViewDesc.Format = m_receiverLeft.GetSenderFormat();
-            shaderResourceViewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-            shaderResourceViewDesc.Texture2D.MostDetailedMip = 0;
-            shaderResourceViewDesc.Texture2D.MipLevels = 1;
-            m_d3dDevice->CreateShaderResourceView(m_receiverLeft.GetSenderTexture(), &shaderResourceViewDesc, &m_receivedTextureViewLeft);
         }
     }
-    else {
-        // A sender was not found or the connected sender closed
-        // Release the texture resource view so render uses the default texture
-        if (m_receivedTextureViewLeft != nullptr) {
-            m_receivedTextureViewLeft->Release();
-            m_receivedTextureViewLeft = nullptr;
+
+    bool receiving = receivedLeft || receivedRight;
+    if (receiving != m_receivingFromSpout) {
+        m_publishPending = true;
+    }
+    m_receivingFromSpout = receiving;
+}
+
+void
+SpoutStereoTile::Publish()
+{
+    if (!m_publishPending) {
+        return;
+    }
+    m_publishPending = false;
+
+    SpoutStereoTileFrame& frame = m_mailbox.back();
+    publishEye(frame.left, m_receiverLeft, m_receivedTextureViewLeft, m_receiveTimeLeft);
+    if (m_parentWindow->stereo()) {
+        publishEye(frame.right, m_receiverRight, m_receivedTextureViewRight, m_receiveTimeRight);
+    }
+    frame.receiving = m_receivingFromSpout;
+    frame.senderNameLeft = m_senderNameLeft;
+    frame.senderNameRight = m_senderNameRight;
+    m_mailbox.Publish();
+}
+
+void
+SpoutStereoTile::publishEye(SpoutStereoEyeFrame& eye, spoutDX& receiver, ID3D11ShaderResourceView* textureView, uint64_t& receiveTime)
+{
+    eye.valid = false;
+    eye.receiveTime = receiveTime;
+    receiveTime = 0;
+    ID3D11Texture2D* source = receiver.GetSenderTexture();
+    if (textureView == nullptr || source == nullptr) {
+        return;
+    }
+
+    // The receiver's texture is overwritten by the next frame while this one may be
+    // drawn, so the mailbox has a copy, in a texture that follows the sender's size
+    D3D11_TEXTURE2D_DESC desc;
+    source->GetDesc(&desc);
+    D3D11_TEXTURE2D_DESC eyeDesc = {};
+    if (eye.texture != nullptr) {
+        eye.texture->GetDesc(&eyeDesc);
+    }
+    if (eye.texture == nullptr || eyeDesc.Width != desc.Width || eyeDesc.Height != desc.Height || eyeDesc.Format != desc.Format) {
+        if (eye.view != nullptr) {
+            eye.view->Release();
+            eye.view = nullptr;
+        }
+        if (eye.texture != nullptr) {
+            eye.texture->Release();
+            eye.texture = nullptr;
+        }
+        desc.Usage = D3D11_USAGE_DEFAULT;
+        desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+        desc.CPUAccessFlags = 0;
+        desc.MiscFlags = 0;
+        SpoutStereoGraphics* graphics = m_parentWindow->graphics();
+        if (FAILED(graphics->CreateTexture(desc, nullptr, &eye.texture)) || eye.texture == nullptr) {
+            return;
+        }
+        D3D11_SHADER_RESOURCE_VIEW_DESC viewDesc = {};
+        viewDesc.Format = receiver.GetSenderFormat();
+        viewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+        viewDesc.Texture2D.MipLevels = 1;
+        if (FAILED(graphics->CreateShaderResourceView(eye.texture, &viewDesc, &eye.view))) {
+            return;
         }
     }
+    m_d3dContext->CopyResource(eye.texture, source);
+    eye.senderFrame = receiver.GetSenderFrame();
+    eye.valid = true;
+}
 
+bool
+SpoutStereoTile::Consume()
+{
+    bool fresh = m_mailbox.Consume();
+    const SpoutStereoTileFrame& frame = m_mailbox.front();
+    m_drawReceiving = frame.receiving;
+    m_drawViewLeft = frame.left.valid ? frame.left.view : nullptr;
+    m_drawFrameLeft = frame.left.senderFrame;
+    m_drawViewRight = frame.right.valid ? frame.right.view : nullptr;
+    m_drawFrameRight = frame.right.senderFrame;
+    if (fresh) {
+        m_damaged = true;
+        m_drawSenderNameLeft = frame.senderNameLeft;
+        m_drawSenderNameRight = frame.senderNameRight;
+        if (frame.left.receiveTime > 0) {
+            m_drawReceiveTimeLeft = frame.left.receiveTime;
+        }
+        if (frame.right.receiveTime > 0) {
+            m_drawReceiveTimeRight = frame.right.receiveTime;
+        }
+    }
+    return fresh;
+}
 
-    // --- RIGHT TEXTURE SPOUT CONNECTION ---
+void
+SpoutStereoTile::ShowReceived()
+{
+    if (m_publishPending) {
+        m_damaged = true;
+        m_drawSenderNameLeft = m_senderNameLeft;
+        m_drawSenderNameRight = m_senderNameRight;
+        m_publishPending = false;
+    }
+    m_drawReceiving = m_receivingFromSpout;
+    m_drawViewLeft = m_receivedTextureViewLeft;
+    m_drawFrameLeft = m_receiverLeft.GetSenderFrame();
+    if (m_receiveTimeLeft > 0) {
+        m_drawReceiveTimeLeft = m_receiveTimeLeft;
+        m_receiveTimeLeft = 0;
+    }
     if (m_parentWindow->stereo()) {
+        m_drawViewRight = m_receivedTextureViewRight;
+        m_drawFrameRight = m_receiverRight.GetSenderFrame();
+        if (m_receiveTimeRight > 0) {
+            m_drawReceiveTimeRight = m_receiveTimeRight;
+            m_receiveTimeRight = 0;
+        }
+    }
+}
 
-        // Receive a new texture
-        if (m_receiverRight.ReceiveTexture()) {
-            receivedRight = true;
-
-            // The D3D11 device within the SpoutDX class could have changed.
-            // If it has switched to use a different sender graphics adapter,
-            // stop receiving the texture and re-initialize the application.
-            if (m_receiverRight.GetAdapterAuto()) {
-                if (m_d3dDevice.Get() != m_receiverRight.GetDX11Device()) {
-                    m_requiresDeviceReset = true;
-                    return;
-                }
-            }
-            // If the frame is new, then create/update the shader resource view
-            if (m_receiverRight.IsFrameNew()) {
-                // release old view if it exists
-                if (m_receivedTextureViewRight != nullptr) {
-                    m_receivedTextureViewRight->Release();
-                    m_receivedTextureViewRight = nullptr;
-                }
-                // create new view
-                D3D11_SHADER_RESOURCE_VIEW_DESC shaderResourceViewDesc;
-                ZeroMemory(&shaderResourceViewDesc, sizeof(shaderResourceViewDesc));
-                // Match format of the sender
-                shaderResourceViewDesc.Format = m_receiverRight.GetSenderFormat();
-                shaderResourceViewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-                shaderResourceViewDesc.Texture2D.MostDetailedMip = 0;
-                shaderResourceViewDesc.Texture2D.MipLevels = 1;
-                m_d3dDevice->CreateShaderResourceView(m_receiverRight.GetSenderTexture(), &shaderResourceViewDesc, &m_receivedTextureViewRight);
-            }
+
+
+void
+SpoutStereoTile::OnPresent(uint64_t presentTime)
+{
+    // Only the first present of a received frame is counted
+    if (m_drawReceiveTimeLeft > 0 && presentTime >= m_drawReceiveTimeLeft) {
+        m_receiveToPresent.Add(presentTime - m_drawReceiveTimeLeft);
+    }
+    if (m_drawReceiveTimeRight > 0 && presentTime >= m_drawReceiveTimeRight) {
+        m_receiveToPresent.Add(presentTime - m_drawReceiveTimeRight);
+    }
+    m_drawReceiveTimeLeft = 0;
+    m_drawReceiveTimeRight = 0;
+}
+
+bool
+SpoutStereoTile::GetSenderFrameRange(long& minFrame, long& maxFrame)
+{
+    // Frame numbers are zero for senders that do not count frames
+    bool found = false;
+    if (m_receivedTextureViewLeft != nullptr && m_receiverLeft.GetSenderFrame() > 0) {
+        minFrame = maxFrame = m_receiverLeft.GetSenderFrame();
+        found = true;
+    }
+    if (m_parentWindow->stereo() && m_receivedTextureViewRight != nullptr && m_receiverRight.GetSenderFrame() > 0) {
+        long frame = m_receiverRight.GetSenderFrame();
+        if (!found) {
+            minFrame = maxFrame = frame;
+            found = true;
         }
         else {
-            // A sender was not found or the connected sender closed
-            // Release the texture resource view so render uses the default texture
-            if (m_receivedTextureViewRight != nullptr) {
-                m_receivedTextureViewRight->Release();
-                m_receivedTextureViewRight = nullptr;
-            }
+            minFrame = std::min(minFrame, frame);
+            maxFrame = std::max(maxFrame, frame);
         }
     }
+    return found;
+}
 
-    m_receivingFromSpout = receivedLeft || receivedRight;
+void
+SpoutStereoTile::LogFrameStats()
+{
+    logFrameStats("left", m_receiverLeft, m_duplicatedLeft);
+    if (m_parentWindow->stereo()) {
+        logFrameStats("right", m_receiverRight, m_duplicatedRight);
+    }
+    if (m_stereoPairFrames > 0) {
+        SpoutLogNotice("Tile %s stereo pairs: %llu frames, %llu mismatched (%.2f%%), %llu waited, wait %s",
+            m_name.c_str(), m_stereoPairFrames.load(), m_stereoPairMismatches.load(),
+            100.0 * (double)m_stereoPairMismatches.load() / (double)m_stereoPairFrames.load(),
+            m_stereoPairWaits, m_stereoPairWaitTime.Summary().c_str());
+        m_stereoPairFrames = 0;
+        m_stereoPairWaits = 0;
+        m_stereoPairMismatches = 0;
+        m_stereoPairWaitTime.Reset();
+    }
+    if (m_publishToReceive.Count() > 0) {
+        SpoutLogNotice("Tile %s latency publish to receive: %s", m_name.c_str(), m_publishToReceive.Summary().c_str());
+        m_publishToReceive.Reset();
+    }
+    if (m_receiveToPresent.Count() > 0) {
+        SpoutLogNotice("Tile %s latency receive to present: %s", m_name.c_str(), m_receiveToPresent.Summary().c_str());
+        m_receiveToPresent.Reset();
+    }
 }
 
+void
+SpoutStereoTile::logFrameStats(const char* eye, spoutDX& receiver, std::atomic<uint64_t>& duplicated)
+{
+    // A sender that froze for the whole interval is logged with no frames
+    SpoutFrameStats stats;
+    const uint64_t duplicatedFrames = duplicated.exchange(0);
+    if (receiver.GetSenderFrameStats(stats)) {
+        SpoutLogNotice("Tile %s %s: %llu frames, interval avg=%.0fus min=%lluus p50=%lluus p95=%lluus p99=%lluus max=%lluus, %llu missed, %llu duplicated",
+            m_name.c_str(), eye, stats.received, stats.smoothed, stats.interval.Min(),
+            stats.interval.Percentile(50.0), stats.interval.Percentile(95.0), stats.interval.Percentile(99.0), stats.interval.Max(),
+            stats.missed, duplicatedFrames);
+    }
+    else {
+        SpoutLogNotice("Tile %s %s: 0 frames, %llu duplicated", m_name.c_str(), eye, duplicatedFrames);
+    }
+    receiver.ResetSenderFrameStats();
+}
 
+bool
+SpoutStereoTile::GetQuadSource(bool rightEye, SpoutStereoQuadSource& source, bool& visible)
+{
+    source.viewport = m_viewport;
+    visible = true;
+    ID3D11ShaderResourceView* view = rightEye ? m_drawViewRight : m_drawViewLeft;
+    if (view) {
+        source.view = view;
+        source.frame = rightEye ? m_drawFrameRight : m_drawFrameLeft;
+        return true;
+    }
+    if (m_neverShowDebugGraphics || !m_showDebugGraphics) {
+        visible = false;
+        return true;
+    }
+    // The sender name is drawn over the default texture
+    if (m_parentWindow->font()) {
+        return false;
+    }
+    source.view = rightEye ? m_defaultTextureViewRight : m_defaultTextureViewLeft;
+    source.frame = -1;
+    return true;
+}
+
+void
+SpoutStereoTile::MarkDrawn()
+{
+    m_damaged = false;
+
+    // A sender frame drawn again is counted once for each frame drawn, not
+    // for each time the receiver found no new frame
+    if (m_drawViewLeft && m_drawFrameLeft > 0) {
+        if (m_drawFrameLeft == m_lastDrawnFrameLeft) {
+            m_duplicatedLeft++;
+        }
+        m_lastDrawnFrameLeft = m_drawFrameLeft;
+    }
+    if (m_parentWindow->stereo() && m_drawViewRight && m_drawFrameRight > 0) {
+        if (m_drawFrameRight == m_lastDrawnFrameRight) {
+            m_duplicatedRight++;
+        }
+        m_lastDrawnFrameRight = m_drawFrameRight;
+    }
+
+    // Count the frames presented with different sender frames in each eye
+    if (m_parentWindow->stereo() && m_drawViewLeft && m_drawViewRight) {
+        long frameLeft = m_drawFrameLeft;
+        long frameRight = m_drawFrameRight;
+        if (frameLeft > 0 && frameRight > 0) {
+            m_stereoPairFrames++;
+            if (frameLeft != frameRight) {
+                m_stereoPairMismatches++;
+            }
+        }
+    }
+}
 
 void
 SpoutStereoTile::Draw(ComPtr<ID3D11RenderTargetView> renderTargetViewLeft, 
                       ComPtr<ID3D11RenderTargetView> renderTargetViewRight)
 {
-    m_d3dContext->RSSetViewports(1, &m_viewport);
+    SpoutStereoGraphics* graphics = m_parentWindow->graphics();
+    graphics->SetViewport(m_viewport);
+    MarkDrawn();
 
     // -- LEFT EYE --
-    m_d3dContext->OMSetRenderTargets(1, renderTargetViewLeft.GetAddressOf(), nullptr);
-
-    m_d3dContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
-    m_d3dContext->VSSetShader(m_parentWindow->fullscreenVertexShader(), nullptr, 0);
-    m_d3dContext->PSSetShader(m_parentWindow->fullscreenPixelShader(), nullptr, 0);
-    m_d3dContext->PSSetSamplers(0, 1, &m_samplerState);
+    graphics->SetRenderTarget(renderTargetViewLeft.Get());
 
-    if (m_receivedTextureViewLeft) {
-        m_d3dContext->PSSetShaderResources(0, 1, &m_receivedTextureViewLeft);
-        m_d3dContext->Draw(4, 0);
+    if (m_drawViewLeft) {
+        graphics->DrawFullscreenQuad(m_drawViewLeft, m_samplerState);
     }
     else if (!m_neverShowDebugGraphics && m_showDebugGraphics) {
-        m_d3dContext->PSSetShaderResources(0, 1, &m_defaultTextureViewLeft);
-        m_d3dContext->Draw(4, 0);
+        graphics->DrawFullscreenQuad(m_defaultTextureViewLeft, m_samplerState);
 
-        m_parentWindow->fontSpriteBatch()->Begin();
-        std::wstring leftSenderW(m_senderNameLeft.length(), L' ');
-        std::copy(m_senderNameLeft.begin(), m_senderNameLeft.end(), leftSenderW.begin());
-        std::wstring output = leftSenderW; // std::wstring(L"Left Eye: ") + leftSenderW;
-        Vector2 bounds = m_parentWindow->font()->MeasureString(output.c_str()) / 2.f;
-        Vector2 pos(m_spoutLabelX + bounds.x, m_spoutLabelY + bounds.y);
-        m_parentWindow->font()->DrawString(m_parentWindow->fontSpriteBatch().get(), output.c_str(), pos, Colors::White, 0.f, bounds);
-        m_parentWindow->fontSpriteBatch()->End();
+        // No text without a device
+        if (m_parentWindow->font()) {
+            m_parentWindow->fontSpriteBatch()->Begin();
+            std::wstring leftSenderW(m_drawSenderNameLeft.length(), L' ');
+            std::copy(m_drawSenderNameLeft.begin(), m_drawSenderNameLeft.end(), leftSenderW.begin());
+            std::wstring output = leftSenderW; // std::wstring(L"Left Eye: ") + leftSenderW;
+            Vector2 bounds = m_parentWindow->font()->MeasureString(output.c_str()) / 2.f;
+            Vector2 pos(m_spoutLabelX + bounds.x, m_spoutLabelY + bounds.y);
+            m_parentWindow->font()->DrawString(m_parentWindow->fontSpriteBatch().get(), output.c_str(), pos, Colors::White, 0.f, bounds);
+            m_parentWindow->fontSpriteBatch()->End();
+            // SpriteBatch sets its own shaders, sampler and texture
+            graphics->InvalidateState();
+        }
     }
 
 
     // -- RIGHT EYE --
     if (m_parentWindow->stereo()) {
-        m_d3dContext->OMSetRenderTargets(1, renderTargetViewRight.GetAddressOf(), nullptr);
-        if (m_receivedTextureViewRight) {
-            m_d3dContext->PSSetShaderResources(0, 1, &m_receivedTextureViewRight);
-            m_d3dContext->Draw(4, 0);
+        graphics->SetRenderTarget(renderTargetViewRight.Get());
+        if (m_drawViewRight) {
+            graphics->DrawFullscreenQuad(m_drawViewRight, m_samplerState);
         }
         else if (!m_neverShowDebugGraphics && m_showDebugGraphics) {
-            m_d3dContext->PSSetShaderResources(0, 1, &m_defaultTextureViewRight);
-            m_d3dContext->Draw(4, 0);
-
-            m_parentWindow->fontSpriteBatch()->Begin();
-            std::wstring rightSenderW(m_senderNameRight.length(), L' ');
-            std::copy(m_senderNameRight.begin(), m_senderNameRight.end(), rightSenderW.begin());
-            std::wstring output = rightSenderW; // std::wstring(L"Right Eye: ") + rightSenderW;
-            Vector2 bounds = m_parentWindow->font()->MeasureString(output.c_str()) / 2.f;
-            Vector2 pos(m_spoutLabelX + bounds.x, m_spoutLabelY + 4 * bounds.y);
-            m_parentWindow->font()->DrawString(m_parentWindow->fontSpriteBatch().get(), output.c_str(), pos, Colors::White, 0.f, bounds);
-            m_parentWindow->fontSpriteBatch()->End();
+            graphics->DrawFullscreenQuad(m_defaultTextureViewRight, m_samplerState);
+
+            // No text without a device
+            if (m_parentWindow->font()) {
+                m_parentWindow->fontSpriteBatch()->Begin();
+                std::wstring rightSenderW(m_drawSenderNameRight.length(), L' ');
+                std::copy(m_drawSenderNameRight.begin(), m_drawSenderNameRight.end(), rightSenderW.begin());
+                std::wstring output = rightSenderW; // std::wstring(L"Right Eye: ") + rightSenderW;
+                Vector2 bounds = m_parentWindow->font()->MeasureString(output.c_str()) / 2.f;
+                Vector2 pos(m_spoutLabelX + bounds.x, m_spoutLabelY + 4 * bounds.y);
+                m_parentWindow->font()->DrawString(m_parentWindow->fontSpriteBatch().get(), output.c_str(), pos, Colors::White, 0.f, bounds);
+                m_parentWindow->fontSpriteBatch()->End();
+                graphics->InvalidateState();
+            }
         }
     }
 }
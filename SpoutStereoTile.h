@@ -4,9 +4,14 @@
 
 #include "SpoutDX/SpoutDX.h"
 #include "StepTimer.h"
+#include "SpoutStereoMailbox.h"
+#include "SpoutStereoComposition.h"
 
 #include <minvr3.h>
 
+#include <atomic>
+#include <chrono>
+
 // forward declaration
 class SpoutStereoWindow;
 
@@ -25,20 +30,63 @@ public:
     void CreateWindowResources();
     void ReleaseWindowResources();
 
+    // Appends the names of the senders this tile receives from, left eye first
+    void GetSenderNames(std::vector<std::string>& names);
+    // Binds sender patterns to matching senders while not receiving, returns
+    // true if a sender name changed
+    bool BindSenderPatterns();
+    // Passes sender info resolved by the window to the receivers, starting at
+    // index, and returns the index of the next tile's first sender
+    size_t PresetSenderInfo(const std::vector<SharedTextureInfo>& info, const std::vector<bool>& found, size_t index);
+
     void Update();
 
+    // With the receive thread, Publish copies the frames received by Update to the
+    // mailbox on the receive thread and Consume takes the newest for the render
+    // thread. Consume returns false if the tile is drawn with the frame it had.
+    void Publish();
+    bool Consume();
+
+    // Without the receive thread, shows the frames received by Update
+    void ShowReceived();
+
     void Draw(Microsoft::WRL::ComPtr<ID3D11RenderTargetView> renderTargetViewLeft, Microsoft::WRL::ComPtr<ID3D11RenderTargetView> renderTargetViewRight);
 
+    // For the window's instanced composition, what Draw would show in one eye. Returns
+    // false if the tile has to Draw itself, as it shows a label. visible is false
+    // if nothing is shown.
+    bool GetQuadSource(bool rightEye, SpoutStereoQuadSource& source, bool& visible);
+
+    // Called by Draw, or by the window when it has drawn the tile's quads
+    void MarkDrawn();
+
+    ID3D11SamplerState* samplerState() {
+        return m_samplerState;
+    }
+
+    std::string name() {
+        return m_name;
+    }
+
     bool getShowDebugGraphics() {
         return m_showDebugGraphics;
     }
 
     void setShowDebugGraphics(bool value) {
+        if (value != m_showDebugGraphics) {
+            m_damaged = true;
+        }
         m_showDebugGraphics = value;
     }
 
+    // What the tile draws has changed since its last Draw
+    bool damaged() {
+        return m_damaged;
+    }
+
+    // Whether the frame being drawn was received from Spout
     bool receivingFromSpout() {
-        return m_receivingFromSpout;
+        return m_drawReceiving;
     }
 
     bool requiresDeviceReset() {
@@ -49,6 +97,27 @@ public:
         m_requiresDeviceReset = false;
     }
 
+    // Number of frames that ReceiveTexture was skipped while waiting for a sender
+    uint64_t skippedReceives() {
+        return m_skippedReceives;
+    }
+
+    // No sender was received by the last Update, on the thread that updates the tile
+    bool waitingForSender() {
+        return !m_receivingFromSpout;
+    }
+
+    // Writes the frame interval statistics of each eye's sender to the Spout log
+    // and starts a new interval
+    void LogFrameStats();
+
+    // Records the latency from receive to present of the frames received since the last present
+    void OnPresent(uint64_t presentTime);
+
+    // Lowest and highest sender frame numbers of the eyes that are displaying
+    // a received texture, returns false if neither eye has a frame number
+    bool GetSenderFrameRange(long& minFrame, long& maxFrame);
+
 protected:
     CD3D11_VIEWPORT m_viewport;
     float m_spoutLabelX;
@@ -56,11 +125,86 @@ protected:
     bool m_neverShowDebugGraphics;
 
     std::string m_name;
+
+    // Sender patterns with one '*' wildcard, bound to the first or newest match
+    bool bindSenderPattern(const std::string& pattern, std::string& senderName, bool& bound, spoutDX& receiver);
+    std::string m_senderPatternLeft;
+    std::string m_senderPatternRight;
+    bool m_senderPatternNewest;
+    // False while the eye's pattern has not matched a sender
+    bool m_senderBoundLeft;
+    bool m_senderBoundRight;
     SpoutStereoWindow* m_parentWindow = nullptr;
     bool m_receivingFromSpout;
-    bool m_requiresDeviceReset;
+    std::atomic<bool> m_requiresDeviceReset;
     bool m_showDebugGraphics;
 
+    // While no sender is connected, only try to receive when the sender list changes
+    bool shouldTryReceive();
+    uint32_t m_waitGeneration;
+    std::chrono::steady_clock::time_point m_lastReceiveAttempt;
+    uint64_t m_skippedReceives;
+
+    // What a received texture view was created for. The receivers copy each frame into
+    // the same texture, so the view is only created again when one of these changes.
+    struct ViewKey {
+        ID3D11Texture2D* texture = nullptr;
+        DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+        UINT width = 0;
+        UINT height = 0;
+
+        bool operator==(const ViewKey& other) const {
+            return texture == other.texture && format == other.format && width == other.width && height == other.height;
+        }
+    };
+    ViewKey m_viewKeyLeft;
+    ViewKey m_viewKeyRight;
+
+    // Receives one eye and updates its shader resource view, returns false if not receiving
+    bool receiveEye(spoutDX& receiver, ID3D11ShaderResourceView*& textureView, ViewKey& viewKey, uint64_t& receiveTime);
+
+    // Frames received since the last Publish, or a change in what is received
+    bool m_publishPending;
+    SpoutStereoFrameMailbox m_mailbox;
+    void publishEye(SpoutStereoEyeFrame& eye, spoutDX& receiver, ID3D11ShaderResourceView* textureView, uint64_t& receiveTime);
+
+    // The frames being drawn, set by Consume or ShowReceived
+    bool m_damaged;
+    bool m_drawReceiving;
+    std::string m_drawSenderNameLeft;
+    std::string m_drawSenderNameRight;
+    ID3D11ShaderResourceView* m_drawViewLeft = nullptr;
+    ID3D11ShaderResourceView* m_drawViewRight = nullptr;
+    long m_drawFrameLeft;
+    long m_drawFrameRight;
+    uint64_t m_drawReceiveTimeLeft;
+    uint64_t m_drawReceiveTimeRight;
+
+    // Writes one eye's frame interval statistics to the Spout log
+    void logFrameStats(const char* eye, spoutDX& receiver, std::atomic<uint64_t>& duplicated);
+    // Frames drawn again with the same sender frame, counted by MarkDrawn
+    long m_lastDrawnFrameLeft;
+    long m_lastDrawnFrameRight;
+    std::atomic<uint64_t> m_duplicatedLeft;
+    std::atomic<uint64_t> m_duplicatedRight;
+
+    // Stereo pair lock, waits for the left and right sender frame numbers to match
+    void lockStereoPair();
+    bool m_stereoPairLock;
+    int m_stereoPairLockTimeoutMs;
+    uint64_t m_stereoPairWaits;
+    // Counted by Draw, which is on another thread than the lock with the receive thread
+    std::atomic<uint64_t> m_stereoPairFrames;
+    std::atomic<uint64_t> m_stereoPairMismatches;
+    spoutLogHistogram m_stereoPairWaitTime;
+
+    // Frame latency in microseconds, from the sender's publish time to receive and from receive to present
+    spoutLogHistogram m_publishToReceive;
+    spoutLogHistogram m_receiveToPresent;
+    // Receive times of the frames received since they were last published or shown
+    uint64_t m_receiveTimeLeft;
+    uint64_t m_receiveTimeRight;
+
     Microsoft::WRL::ComPtr<ID3D11Device> m_d3dDevice;
     Microsoft::WRL::ComPtr<ID3D11DeviceContext> m_d3dContext;
 
@@ -0,0 +1,160 @@
+#include "pch.h"
+#include "SpoutStereoTrace.h"
+
+#include <minvr3.h>
+
+#include <cstdio>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+    struct TraceEvent {
+        const char* name;
+        uint64_t start;
+        uint64_t duration;
+    };
+
+    // Written only by its own thread. The count is published after each event
+    // so that Flush can read the buffer from another thread.
+    struct TraceBuffer {
+        std::vector<TraceEvent> events;
+        std::atomic<uint64_t> count;
+        DWORD threadId;
+        std::string threadName;
+    };
+
+    std::mutex s_buffersMutex;
+    std::vector<TraceBuffer*> s_buffers;
+    std::string s_traceFile = "SpoutStereoServer-trace.json";
+    size_t s_maxEvents = 65536;
+    int s_flushIntervalSeconds = 0;
+    uint64_t s_lastFlush = 0;
+
+    // A thread's buffer is allocated with its first event, so that threads
+    // are not given a buffer when tracing is disabled
+    thread_local TraceBuffer* t_buffer = nullptr;
+    thread_local std::string t_threadName;
+
+    TraceBuffer* threadBuffer() {
+        if (t_buffer == nullptr) {
+            TraceBuffer* buffer = new TraceBuffer();
+            buffer->events.resize(s_maxEvents);
+            buffer->count.store(0, std::memory_order_relaxed);
+            buffer->threadId = GetCurrentThreadId();
+            buffer->threadName = t_threadName;
+            std::lock_guard<std::mutex> lock(s_buffersMutex);
+            s_buffers.push_back(buffer);
+            t_buffer = buffer;
+        }
+        return t_buffer;
+    }
+
+    void writeEscaped(FILE* file, const char* text) {
+        for (const char* c = text; *c; c++) {
+            if (*c == '"' || *c == '\\') {
+                fputc('\\', file);
+            }
+            if ((unsigned char)*c >= 0x20) {
+                fputc(*c, file);
+            }
+        }
+    }
+
+}
+
+std::atomic<bool> SpoutStereoTrace::s_enabled(false);
+
+void
+SpoutStereoTrace::Initialize()
+{
+    s_traceFile = ConfigVal::Get("TRACE_FILE", s_traceFile);
+    int maxEvents = ConfigVal::Get("TRACE_MAX_EVENTS", 65536);
+    s_maxEvents = (maxEvents > 0) ? (size_t)maxEvents : 65536;
+    s_flushIntervalSeconds = ConfigVal::Get("TRACE_FLUSH_INTERVAL_SECONDS", 0);
+    s_lastFlush = spoutstats::NowMicroseconds();
+    s_enabled.store(ConfigVal::Get("TRACE_ENABLED", false), std::memory_order_relaxed);
+    if (enabled()) {
+        std::cout << "Tracing the frame loop to " << s_traceFile << std::endl;
+    }
+}
+
+void
+SpoutStereoTrace::Record(const char* name, uint64_t start, uint64_t end)
+{
+    TraceBuffer* buffer = threadBuffer();
+    uint64_t index = buffer->count.load(std::memory_order_relaxed);
+    TraceEvent& event = buffer->events[index % buffer->events.size()];
+    event.name = name;
+    event.start = start;
+    event.duration = end - start;
+    buffer->count.store(index + 1, std::memory_order_release);
+}
+
+void
+SpoutStereoTrace::SetThreadName(const std::string& name)
+{
+    t_threadName = name;
+    if (t_buffer != nullptr) {
+        std::lock_guard<std::mutex> lock(s_buffersMutex);
+        t_buffer->threadName = name;
+    }
+}
+
+bool
+SpoutStereoTrace::Flush()
+{
+    if (!enabled()) {
+        return false;
+    }
+    FILE* file = nullptr;
+    if (fopen_s(&file, s_traceFile.c_str(), "w") != 0 || file == nullptr) {
+        std::cerr << "Could not write trace file " << s_traceFile << std::endl;
+        return false;
+    }
+
+    // Events still being written by other threads while the buffers are read
+    // may be from the next pass of the ring, which only affects the oldest events
+    DWORD processId = GetCurrentProcessId();
+    size_t written = 0;
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    {
+        std::lock_guard<std::mutex> lock(s_buffersMutex);
+        for (auto buffer = s_buffers.begin(); buffer != s_buffers.end(); buffer++) {
+            if (!(*buffer)->threadName.empty()) {
+                fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%lu,\"tid\":%lu,\"args\":{\"name\":\"",
+                    written > 0 ? ",\n" : "", processId, (*buffer)->threadId);
+                writeEscaped(file, (*buffer)->threadName.c_str());
+                fprintf(file, "\"}}");
+                written++;
+            }
+            uint64_t count = (*buffer)->count.load(std::memory_order_acquire);
+            uint64_t size = (*buffer)->events.size();
+            uint64_t first = (count > size) ? count - size : 0;
+            for (uint64_t i = first; i < count; i++) {
+                const TraceEvent& event = (*buffer)->events[i % size];
+                fprintf(file, "%s{\"name\":\"", written > 0 ? ",\n" : "");
+                writeEscaped(file, event.name);
+                fprintf(file, "\",\"ph\":\"X\",\"ts\":%llu,\"dur\":%llu,\"pid\":%lu,\"tid\":%lu}",
+                    event.start, event.duration, processId, (*buffer)->threadId);
+                written++;
+            }
+        }
+    }
+    fprintf(file, "\n]}\n");
+    fclose(file);
+
+    s_lastFlush = spoutstats::NowMicroseconds();
+    std::cout << "Wrote " << written << " trace events to " << s_traceFile << std::endl;
+    return true;
+}
+
+void
+SpoutStereoTrace::FlushIfDue()
+{
+    if (enabled() && s_flushIntervalSeconds > 0 &&
+        spoutstats::NowMicroseconds() - s_lastFlush >= (uint64_t)s_flushIntervalSeconds * 1000000) {
+        Flush();
+    }
+}
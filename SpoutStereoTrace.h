@@ -0,0 +1,73 @@
+#pragma once
+
+#include "pch.h"
+
+#include "SpoutDX/SpoutStats.h"
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Scoped trace zones for the frame loop, written as a Chrome trace JSON file
+// that can be opened in chrome://tracing or https://ui.perfetto.dev
+//
+// Each thread records complete events into its own ring buffer, which holds the
+// most recent TRACE_MAX_EVENTS events, so recording an event takes no lock.
+// When tracing is disabled, a zone costs one relaxed load and a branch.
+class SpoutStereoTrace
+{
+public:
+
+    // Reads TRACE_ENABLED, TRACE_FILE, TRACE_MAX_EVENTS and TRACE_FLUSH_INTERVAL_SECONDS
+    static void Initialize();
+
+    static bool enabled() {
+        return s_enabled.load(std::memory_order_relaxed);
+    }
+
+    // Records an event from start to end, in microseconds from spoutstats::NowMicroseconds
+    static void Record(const char* name, uint64_t start, uint64_t end);
+
+    // Names the calling thread in the trace
+    static void SetThreadName(const std::string& name);
+
+    // Writes the events in all threads' buffers to the trace file
+    static bool Flush();
+
+    // Flushes if TRACE_FLUSH_INTERVAL_SECONDS has passed since the last flush
+    static void FlushIfDue();
+
+private:
+    static std::atomic<bool> s_enabled;
+};
+
+// Records the time from construction to destruction as a trace event.
+// The name must remain valid until the trace is flushed.
+class SpoutStereoTraceZone
+{
+public:
+    explicit SpoutStereoTraceZone(const char* name) : m_name(name), m_start(0) {
+        if (SpoutStereoTrace::enabled()) {
+            m_start = spoutstats::NowMicroseconds();
+        }
+    }
+
+    ~SpoutStereoTraceZone() {
+        if (m_start != 0) {
+            SpoutStereoTrace::Record(m_name, m_start, spoutstats::NowMicroseconds());
+        }
+    }
+
+    SpoutStereoTraceZone(const SpoutStereoTraceZone&) = delete;
+    SpoutStereoTraceZone& operator=(const SpoutStereoTraceZone&) = delete;
+
+private:
+    const char* m_name;
+    uint64_t m_start;
+};
+
+#define SPOUT_TRACE_CONCAT_INNER(a, b) a##b
+#define SPOUT_TRACE_CONCAT(a, b) SPOUT_TRACE_CONCAT_INNER(a, b)
+
+// Traces the rest of the enclosing scope
+#define SPOUT_TRACE_ZONE(name) SpoutStereoTraceZone SPOUT_TRACE_CONCAT(traceZone, __LINE__)(name)
@@ -1,20 +1,37 @@
 #include "pch.h"
 #include "SpoutStereoWindow.h"
-#include "Generated Files/PixelShader.h"
-#include "Generated Files/VertexShader.h"
+#include "SpoutStereoTrace.h"
+
+#include <d3d11_4.h>
+#include <thread>
 
 using namespace DirectX;
 using namespace DirectX::SimpleMath;
 
 using Microsoft::WRL::ComPtr;
 
-SpoutStereoWindow::SpoutStereoWindow() : m_lastReceivingFromSpout(false)
+// After this many frames in a row reach the barrier timeout, the barrier is suspended until
+// the tiles' frame numbers match by themselves, e.g. senders that started counting at different times
+static const int FrameBarrierMaxTimeoutsInRow = 8;
+
+// Longest wait of the receive thread for a sender list change, bounds the time to stop the thread
+static const int ReceiveThreadSenderWaitMs = 100;
+
+SpoutStereoWindow::SpoutStereoWindow() : m_lastReceivingFromSpout(false), m_batchSenderResolve(false), m_senderRetryInterval(1000), m_senderListGeneration(0),
+    m_parallelTileUpdate(false), m_receiveThreadEnabled(false), m_receiveThreadFps(0), m_receiveThreadStop(false), m_receiveStatsRequested(false),
+    m_tileFramesDrawn(0), m_tileFramesStale(0), m_damageTracking(false), m_damaged(true), m_framesDrawn(0), m_framesSkipped(0),
+    m_instancedComposition(false), m_framesInstanced(0), m_framesPerTile(0),
+    m_lockStats(false), m_statsLogIntervalSeconds(0),
+    m_frameBarrier(false), m_frameBarrierTimeoutMs(0), m_frameBarrierSuspended(false), m_frameBarrierTimeoutsInRow(0),
+    m_frameBarrierFrames(0), m_frameBarrierWaits(0), m_frameBarrierTimeouts(0)
 {
 
 }
 
 SpoutStereoWindow::~SpoutStereoWindow()
 {
+    stopReceiveThread();
+    m_tileWorkers.Stop();
 	for (auto tile = m_tiles.begin(); tile != m_tiles.end(); tile++) {
 		delete (*tile);
 	}
@@ -26,6 +43,7 @@ SpoutStereoWindow::Initialize(HWND window, bool stereo)
 {
 	m_window = window;
     m_stereo = stereo;
+    m_graphicsBackend = ConfigVal::Get("GRAPHICS_BACKEND", std::string("d3d11"));
 
 	// create tiles based on config file settings
 	std::vector<std::string> tileNames = ConfigVal::Get("TILES", std::vector<std::string>());
@@ -35,6 +53,43 @@ SpoutStereoWindow::Initialize(HWND window, bool stereo)
 		m_tiles.push_back(tile);
 	}
 
+    // One registry pass per frame for all tiles instead of one per receiver
+    m_batchSenderResolve = ConfigVal::Get("BATCH_SENDER_RESOLVE", true);
+    m_senderRetryInterval = std::chrono::milliseconds(ConfigVal::Get("SENDER_RETRY_INTERVAL_MS", 1000));
+    int cleanupIntervalMs = ConfigVal::Get("SENDER_CLEANUP_INTERVAL_MS", 0);
+    if (cleanupIntervalMs > 0) {
+        m_senderNames.StartSenderCleanup((DWORD)cleanupIntervalMs);
+    }
+    m_senderNameList.clear();
+    for (auto tile = m_tiles.begin(); tile != m_tiles.end(); tile++) {
+        (*tile)->GetSenderNames(m_senderNameList);
+    }
+
+    // Update the tiles in parallel, by default with one thread per tile up to the number of cores
+    m_parallelTileUpdate = ConfigVal::Get("PARALLEL_TILE_UPDATE", false);
+    if (m_parallelTileUpdate) {
+        int threads = ConfigVal::Get("TILE_UPDATE_THREADS", 0);
+        if (threads <= 0) {
+            threads = (std::min)((int)m_tiles.size(), (int)std::thread::hardware_concurrency());
+        }
+        // The main loop's thread updates tiles too
+        m_tileWorkers.Start((std::max)(threads - 1, 0));
+    }
+
+    // Receive on a thread of its own, the main loop draws the newest frames received
+    m_receiveThreadEnabled = ConfigVal::Get("RECEIVE_THREAD", false);
+    m_receiveThreadFps = ConfigVal::Get("RECEIVE_THREAD_FPS", 240);
+
+    // Skip drawing and presenting frames in which nothing changed
+    m_damageTracking = ConfigVal::Get("DAMAGE_TRACKING", false);
+
+    // Draw all tiles in each eye with one instanced draw instead of a draw per tile
+    m_compositionMode = ConfigVal::Get("COMPOSITION_MODE", std::string("tiles"));
+    if (m_compositionMode != "tiles" && m_compositionMode != "instanced") {
+        std::cout << "Warning: Unknown COMPOSITION_MODE '" << m_compositionMode << "', using tiles" << std::endl;
+        m_compositionMode = "tiles";
+    }
+
 	// Init MinVR Event Connection
 	m_openMinVREventConnection = ConfigVal::Get("OPEN_MINVR_EVENT_CONNECTION", true);
 	m_port = ConfigVal::Get("MINVR_EVENT_CONNECTION_PORT", 9030);
@@ -44,6 +99,31 @@ SpoutStereoWindow::Initialize(HWND window, bool stereo)
 		MinVR3Net::CreateListener(m_port, &m_listenerFd);
 	}
 
+    // Init performance statistics
+    m_lockStats = ConfigVal::Get("LOCK_STATS", false);
+    m_statsLogIntervalSeconds = ConfigVal::Get("STATS_LOG_INTERVAL_SECONDS", 0);
+    SpoutSharedMemory::EnableLockStats(m_lockStats);
+    if (m_statsLogIntervalSeconds > 0) {
+        std::string logFile = ConfigVal::Get("SPOUT_LOG_FILE", std::string());
+        if (logFile.empty()) {
+            spoututils::EnableSpoutLog();
+        }
+        else {
+            spoututils::EnableSpoutLogFile(logFile.c_str());
+        }
+    }
+    m_lastStatsLogTime = std::chrono::steady_clock::now();
+
+    // Init frame pacing, 0 presents on the display's vertical sync
+    int framePacerFps = ConfigVal::Get("FRAME_PACER_FPS", 0);
+    if (framePacerFps > 0) {
+        m_framePacer.SetFps((double)framePacerFps);
+    }
+
+    // Init frame barrier across tiles
+    m_frameBarrier = ConfigVal::Get("FRAME_BARRIER", false);
+    m_frameBarrierTimeoutMs = ConfigVal::Get("FRAME_BARRIER_TIMEOUT_MS", 8);
+
     // Init DX input devices
     m_keyboard = std::make_unique<Keyboard>();
     m_mouse = std::make_unique<Mouse>();
@@ -57,32 +137,55 @@ SpoutStereoWindow::CreateDeviceResources(Microsoft::WRL::ComPtr<ID3D11Device> d3
     m_d3dDevice = d3dDevice;
     m_d3dContext = d3dContext;
 
-    m_font = std::make_unique<SpriteFont>(m_d3dDevice.Get(), L"CourierNew-32.spritefont");
-    m_spriteBatch = std::make_unique<SpriteBatch>(m_d3dContext.Get());
+    m_graphics = SpoutStereoGraphics::Create(m_graphicsBackend, m_d3dDevice, m_d3dContext);
 
-    // Create simple shaders for fullscreen quad (these are compiled into header files during the build)
-    // Right-click on the .hlsl files and go to Properties to configure this.
-    DX::ThrowIfFailed(
-        m_d3dDevice->CreateVertexShader(g_vertexshader, sizeof(g_vertexshader), nullptr, &m_fullscreenVertexShader)
-    );
-    DX::ThrowIfFailed(
-        m_d3dDevice->CreatePixelShader(g_pixelshader, sizeof(g_pixelshader), nullptr, &m_fullscreenPixelShader)
-    );
+    // The receivers share the immediate context, which must be protected to be used by the
+    // tile update and receive threads. Without a device (the null backend) each receiver has its own.
+    if ((m_parallelTileUpdate || m_receiveThreadEnabled) && m_d3dContext) {
+        ComPtr<ID3D11Multithread> multithread;
+        if (SUCCEEDED(m_d3dContext.As(&multithread))) {
+            multithread->SetMultithreadProtected(TRUE);
+        }
+        else {
+            std::cout << "Warning: The D3D11 context cannot be multithread protected, tiles will update sequentially on the main loop's thread" << std::endl;
+            m_tileWorkers.Stop();
+            m_receiveThreadEnabled = false;
+        }
+    }
+    m_instancedComposition = (m_compositionMode == "instanced");
+    if (m_instancedComposition && !m_graphics->supportsInstancedQuads()) {
+        std::cout << "Warning: GRAPHICS_BACKEND " << m_graphicsBackend << " does not support COMPOSITION_MODE instanced, using tiles" << std::endl;
+        m_instancedComposition = false;
+    }
+    if (!m_graphics->headless()) {
+        m_font = std::make_unique<SpriteFont>(m_d3dDevice.Get(), L"CourierNew-32.spritefont");
+        m_spriteBatch = std::make_unique<SpriteBatch>(m_d3dContext.Get());
+    }
 
     for (auto tile = m_tiles.begin(); tile != m_tiles.end(); tile++) {
         (*tile)->CreateDeviceResources(m_d3dDevice, m_d3dContext);
     }
+
+    if (m_receiveThreadEnabled) {
+        startReceiveThread();
+    }
+    m_damaged = true;
 }
 
 void 
 SpoutStereoWindow::ReleaseDeviceResources()
 {
+    stopReceiveThread();
+
     for (auto tile = m_tiles.begin(); tile != m_tiles.end(); tile++) {
         (*tile)->ReleaseDeviceResources();
     }
+    m_compositionLeft.ReleaseDeviceResources();
+    m_compositionRight.ReleaseDeviceResources();
 
     m_font.reset();
     m_spriteBatch.reset();
+    m_graphics.reset();
     m_d3dContext.Reset();
     m_d3dDevice.Reset();
 }
@@ -93,12 +196,19 @@ SpoutStereoWindow::CreateWindowResources()
     for (auto tile = m_tiles.begin(); tile != m_tiles.end(); tile++) {
         (*tile)->CreateWindowResources();
     }
+    // The new back buffers have not been drawn
+    m_damaged = true;
 }
 
 
 void 
 SpoutStereoWindow::ReleaseWindowResources()
 {
+    if (m_graphics) {
+        m_graphics->ReleaseRenderTargets();
+        // Game unbinds the render targets before releasing them
+        m_graphics->InvalidateState();
+    }
     for (auto tile = m_tiles.begin(); tile != m_tiles.end(); tile++) {
         (*tile)->ReleaseWindowResources();
     }
@@ -149,8 +259,23 @@ SpoutStereoWindow::PollKeyUpDownEvent(DirectX::Keyboard::Keys keyId, const std::
 void
 SpoutStereoWindow::Update()
 {
-    for (auto tile = m_tiles.begin(); tile != m_tiles.end(); tile++) {
-        (*tile)->Update();
+    if (m_receiveThread.joinable()) {
+        // Draw the newest frame of each tile, counting the tiles that have none since the last frame
+        for (auto tile = m_tiles.begin(); tile != m_tiles.end(); tile++) {
+            bool fresh = (*tile)->Consume();
+            if ((*tile)->receivingFromSpout()) {
+                m_tileFramesDrawn++;
+                if (!fresh) {
+                    m_tileFramesStale++;
+                }
+            }
+        }
+    }
+    else {
+        receiveTiles();
+        for (auto tile = m_tiles.begin(); tile != m_tiles.end(); tile++) {
+            (*tile)->ShowReceived();
+        }
     }
 
     bool receivingFromSpoutThisFrame = receivingFromSpout();
@@ -162,6 +287,15 @@ SpoutStereoWindow::Update()
     }
     m_lastReceivingFromSpout = receivingFromSpoutThisFrame;
 
+    if (m_statsLogIntervalSeconds > 0) {
+        auto now = std::chrono::steady_clock::now();
+        if (now - m_lastStatsLogTime >= std::chrono::seconds(m_statsLogIntervalSeconds)) {
+            LogStats();
+            m_lastStatsLogTime = now;
+        }
+    }
+
+    SpoutStereoTrace::FlushIfDue();
 
     m_keyboardStateTracker.Update(m_keyboard->GetState());
     m_mouseStateTracker.Update(m_mouse->GetState());
@@ -171,7 +305,14 @@ SpoutStereoWindow::Update()
         ShowWindow(m_window, SW_MINIMIZE);
     }
 
+    if (m_keyboardStateTracker.pressed.F9) {
+        // Write the recent frame loop timeline when TRACE_ENABLED
+        SpoutStereoTrace::Flush();
+    }
+
 	if (m_openMinVREventConnection) {
+        SPOUT_TRACE_ZONE("MinVR events");
+
 		// Accept new connections from any clients trying to connect
 		while (MinVR3Net::IsReadyToRead(&m_listenerFd)) {
 			SOCKET newClientFd;
@@ -294,22 +435,387 @@ SpoutStereoWindow::Update()
     } // end MinVR event connection updates
 }
 
+void
+SpoutStereoWindow::receiveTiles()
+{
+    bool senderNamesChanged = false;
+    for (auto tile = m_tiles.begin(); tile != m_tiles.end(); tile++) {
+        senderNamesChanged = (*tile)->BindSenderPatterns() || senderNamesChanged;
+    }
+    if (senderNamesChanged) {
+        m_senderNameList.clear();
+        for (auto tile = m_tiles.begin(); tile != m_tiles.end(); tile++) {
+            (*tile)->GetSenderNames(m_senderNameList);
+        }
+    }
+
+    if (m_batchSenderResolve) {
+        m_senderNames.ResolveSenders(m_senderNameList, m_senderInfoList, m_senderFoundList);
+        size_t index = 0;
+        for (auto tile = m_tiles.begin(); tile != m_tiles.end(); tile++) {
+            index = (*tile)->PresetSenderInfo(m_senderInfoList, m_senderFoundList, index);
+        }
+    }
+
+    m_senderListGeneration = m_senderNames.GetSenderListGeneration();
+
+    {
+        SPOUT_TRACE_ZONE("Receive");
+        uint64_t start = spoutstats::NowMicroseconds();
+        if (m_tileWorkers.threads() > 0) {
+            m_tileWorkers.Run((int)m_tiles.size(), [this](int index) {
+                m_tiles[index]->Update();
+            });
+        }
+        else {
+            for (auto tile = m_tiles.begin(); tile != m_tiles.end(); tile++) {
+                (*tile)->Update();
+            }
+        }
+        m_tileUpdateTime.Add(spoutstats::NowMicroseconds() - start);
+    }
+
+    if (m_frameBarrier) {
+        waitForFrameBarrier();
+    }
+}
+
+void
+SpoutStereoWindow::startReceiveThread()
+{
+    stopReceiveThread();
+    m_receiveThreadStop = false;
+    m_receiveThread = std::thread(&SpoutStereoWindow::receiveLoop, this);
+}
+
+void
+SpoutStereoWindow::stopReceiveThread()
+{
+    if (m_receiveThread.joinable()) {
+        m_receiveThreadStop = true;
+        m_receiveThread.join();
+    }
+}
+
+void
+SpoutStereoWindow::receiveLoop()
+{
+    SpoutStereoTrace::SetThreadName("Receive thread");
+
+    spoutFramePacer pacer;
+    pacer.SetFps((double)(std::max)(m_receiveThreadFps, 1));
+    while (!m_receiveThreadStop) {
+        receiveTiles();
+        for (auto tile = m_tiles.begin(); tile != m_tiles.end(); tile++) {
+            (*tile)->Publish();
+        }
+
+        // The receive statistics are written on this thread when the main loop asks
+        if (m_receiveStatsRequested.exchange(false)) {
+            logReceiveStats();
+        }
+
+        // While no tile has a sender, sleep until a sender is registered or released
+        // instead of polling. The wait is short enough to stop the thread promptly
+        // and to retry senders that do not use the registry.
+        bool waiting = !m_tiles.empty();
+        for (auto tile = m_tiles.begin(); tile != m_tiles.end(); tile++) {
+            waiting = waiting && (*tile)->waitingForSender();
+        }
+        if (waiting) {
+            DWORD timeout = (DWORD)(std::min)(m_senderRetryInterval.count(), (long long)ReceiveThreadSenderWaitMs);
+            m_senderNames.WaitForSenderChange(m_senderListGeneration, timeout);
+        }
+        else {
+            pacer.Wait();
+        }
+    }
+}
+
+
+bool
+SpoutStereoWindow::NeedsDraw()
+{
+    if (!m_damageTracking || m_damaged) {
+        return true;
+    }
+    for (auto tile = m_tiles.begin(); tile != m_tiles.end(); tile++) {
+        if ((*tile)->damaged()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void
+SpoutStereoWindow::SkipFrame(IDXGISwapChain* swapChain)
+{
+    m_framesSkipped++;
+    if (framePaced()) {
+        m_framePacer.Wait();
+        return;
+    }
+    // The swap chain keeps showing the last frame presented
+    ComPtr<IDXGIOutput> output;
+    if (swapChain != nullptr && SUCCEEDED(swapChain->GetContainingOutput(&output))) {
+        output->WaitForVBlank();
+    }
+}
 
 void
 SpoutStereoWindow::Draw(ComPtr<ID3D11RenderTargetView> renderTargetViewLeft, 
                         ComPtr<ID3D11RenderTargetView> renderTargetViewRight)
 {
+    m_damaged = false;
+    m_framesDrawn++;
+    uint64_t start = spoutstats::NowMicroseconds();
+
     // LEFT EYE
-    m_d3dContext->OMSetRenderTargets(1, renderTargetViewLeft.GetAddressOf(), nullptr);
-    m_d3dContext->ClearRenderTargetView(renderTargetViewLeft.Get(), Colors::Red);
+    m_graphics->SetRenderTarget(renderTargetViewLeft.Get());
+    m_graphics->ClearRenderTarget(renderTargetViewLeft.Get(), Colors::Red);
 
     if (renderTargetViewRight) {
         // RIGHT EYE
-        m_d3dContext->OMSetRenderTargets(1, renderTargetViewRight.GetAddressOf(), nullptr);
-        m_d3dContext->ClearRenderTargetView(renderTargetViewRight.Get(), Colors::Blue);
+        m_graphics->SetRenderTarget(renderTargetViewRight.Get());
+        m_graphics->ClearRenderTarget(renderTargetViewRight.Get(), Colors::Blue);
+    }
+
+    if (m_instancedComposition && drawInstanced(renderTargetViewLeft.Get(), renderTargetViewRight.Get())) {
+        m_framesInstanced++;
     }
+    else {
+        for (auto tile = m_tiles.begin(); tile != m_tiles.end(); tile++) {
+            (*tile)->Draw(renderTargetViewLeft, renderTargetViewRight);
+        }
+        m_framesPerTile++;
+    }
+    m_drawTime.Add(spoutstats::NowMicroseconds() - start);
+}
 
+bool
+SpoutStereoWindow::drawInstanced(ID3D11RenderTargetView* renderTargetViewLeft, ID3D11RenderTargetView* renderTargetViewRight)
+{
+    if (m_tiles.empty()) {
+        return false;
+    }
+    m_quadSourcesLeft.clear();
+    m_quadSourcesRight.clear();
     for (auto tile = m_tiles.begin(); tile != m_tiles.end(); tile++) {
-        (*tile)->Draw(renderTargetViewLeft, renderTargetViewRight);
+        SpoutStereoQuadSource source;
+        bool visible;
+        if (!(*tile)->GetQuadSource(false, source, visible)) {
+            return false;
+        }
+        if (visible) {
+            m_quadSourcesLeft.push_back(source);
+        }
+        if (renderTargetViewRight) {
+            source = SpoutStereoQuadSource();
+            if (!(*tile)->GetQuadSource(true, source, visible)) {
+                return false;
+            }
+            if (visible) {
+                m_quadSourcesRight.push_back(source);
+            }
+        }
+    }
+    if (!m_compositionLeft.Prepare(m_graphics.get(), m_quadSourcesLeft)) {
+        return false;
+    }
+    if (renderTargetViewRight && !m_compositionRight.Prepare(m_graphics.get(), m_quadSourcesRight)) {
+        return false;
+    }
+
+    // The tiles' samplers have the same description, so D3D11 created them as one
+    ID3D11SamplerState* sampler = m_tiles.front()->samplerState();
+    m_graphics->SetRenderTarget(renderTargetViewLeft);
+    m_compositionLeft.Draw(m_graphics.get(), sampler);
+    if (renderTargetViewRight) {
+        m_graphics->SetRenderTarget(renderTargetViewRight);
+        m_compositionRight.Draw(m_graphics.get(), sampler);
+    }
+    for (auto tile = m_tiles.begin(); tile != m_tiles.end(); tile++) {
+        (*tile)->MarkDrawn();
+    }
+    return true;
+}
+
+HRESULT
+SpoutStereoWindow::Present(IDXGISwapChain* swapChain, UINT syncInterval)
+{
+    return m_graphics->Present(swapChain, syncInterval);
+}
+
+void
+SpoutStereoWindow::LogStats()
+{
+    if (m_lockStats) {
+        // Each dump covers the interval since the previous one
+        SpoutSharedMemory::LogLockStats(true);
+    }
+    if (m_receiveThread.joinable()) {
+        // The receive statistics belong to the receive thread, which writes them after its next pass
+        m_receiveStatsRequested = true;
+        if (m_tileFramesDrawn > 0) {
+            SpoutLogNotice("Receive thread: %llu tile frames drawn, %llu without a new frame (%.2f%%)",
+                m_tileFramesDrawn, m_tileFramesStale, 100.0 * (double)m_tileFramesStale / (double)m_tileFramesDrawn);
+            m_tileFramesDrawn = 0;
+            m_tileFramesStale = 0;
+        }
+    }
+    else {
+        logReceiveStats();
+    }
+    if (m_damageTracking && m_framesDrawn + m_framesSkipped > 0) {
+        SpoutLogNotice("Damage tracking: %llu frames drawn, %llu skipped (%.2f%%)",
+            m_framesDrawn, m_framesSkipped, 100.0 * (double)m_framesSkipped / (double)(m_framesDrawn + m_framesSkipped));
+    }
+    m_framesDrawn = 0;
+    m_framesSkipped = 0;
+    if (m_drawTime.Count() > 0) {
+        SpoutLogNotice("Composition %s: draw %s, %llu frames instanced, %llu drawn per tile",
+            m_compositionMode.c_str(), m_drawTime.Summary().c_str(), m_framesInstanced, m_framesPerTile);
+        m_drawTime.Reset();
+    }
+    m_framesInstanced = 0;
+    m_framesPerTile = 0;
+    spoutLogHistogram jitter;
+    if (m_framePacer.GetJitter(jitter)) {
+        SpoutLogNotice("Frame pacer %.0f fps: deviation %s, %llu missed, %llu resyncs, spin margin %.0fus",
+            m_framePacer.GetFps(), jitter.Summary().c_str(),
+            m_framePacer.GetMissed(), m_framePacer.GetResyncs(), m_framePacer.GetSpinMargin());
+        m_framePacer.ResetStats();
+    }
+    if (m_graphics) {
+        const SpoutStereoGraphicsCounters& counters = m_graphics->counters();
+        SpoutLogNotice("Graphics %s: %llu presents, %llu quads, %llu render targets, %llu viewports, %llu clears, created %llu textures, %llu views, %llu samplers",
+            m_graphicsBackend.c_str(), counters.presents.load(), counters.quadsDrawn.load(), counters.renderTargetsSet.load(),
+            counters.viewportsSet.load(), counters.clears.load(), counters.texturesCreated.load(), counters.viewsCreated.load(),
+            counters.samplersCreated.load());
+        SpoutLogNotice("Graphics %s: %llu quad state sets, %llu sets elided as already bound",
+            m_graphicsBackend.c_str(), counters.stateSets.load(), counters.stateSetsElided.load());
+        if (m_instancedComposition) {
+            SpoutLogNotice("Graphics %s: %llu instanced draws of %llu quads, %llu texture array slices copied",
+                m_graphicsBackend.c_str(), counters.instancedDraws.load(), counters.instancedQuads.load(), counters.arraySlicesCopied.load());
+        }
+        m_graphics->resetCounters();
+    }
+}
+
+void
+SpoutStereoWindow::logReceiveStats()
+{
+    for (auto tile = m_tiles.begin(); tile != m_tiles.end(); tile++) {
+        if ((*tile)->skippedReceives() > 0) {
+            SpoutLogNotice("Tile %s: %llu frames skipped waiting for a sender",
+                (*tile)->name().c_str(), (*tile)->skippedReceives());
+        }
+        (*tile)->LogFrameStats();
+    }
+    if (m_tileUpdateTime.Count() > 0) {
+        SpoutLogNotice("Tile update on %d threads: %s", m_tileWorkers.threads() + 1, m_tileUpdateTime.Summary().c_str());
+        m_tileUpdateTime.Reset();
+    }
+    if (m_frameBarrierFrames > 0) {
+        SpoutLogNotice("Frame barrier: %llu frames, %llu waited, %llu timed out%s, wait %s",
+            m_frameBarrierFrames, m_frameBarrierWaits, m_frameBarrierTimeouts,
+            m_frameBarrierSuspended ? " (suspended)" : "", m_frameBarrierWaitTime.Summary().c_str());
+        m_frameBarrierFrames = 0;
+        m_frameBarrierWaits = 0;
+        m_frameBarrierTimeouts = 0;
+        m_frameBarrierWaitTime.Reset();
+    }
+}
+
+void
+SpoutStereoWindow::waitForFrameBarrier()
+{
+    SPOUT_TRACE_ZONE("Frame barrier");
+
+    // Lowest and highest sender frame numbers over all tiles
+    auto frameRange = [this](long& minFrame, long& maxFrame) {
+        int sources = 0;
+        for (auto tile = m_tiles.begin(); tile != m_tiles.end(); tile++) {
+            long tileMin = 0;
+            long tileMax = 0;
+            if ((*tile)->GetSenderFrameRange(tileMin, tileMax)) {
+                minFrame = (sources == 0) ? tileMin : std::min(minFrame, tileMin);
+                maxFrame = (sources == 0) ? tileMax : std::max(maxFrame, tileMax);
+                sources++;
+            }
+        }
+        return sources;
+    };
+
+    long minFrame = 0;
+    long maxFrame = 0;
+    if (frameRange(minFrame, maxFrame) == 0) {
+        return;
+    }
+    m_frameBarrierFrames++;
+
+    if (minFrame == maxFrame) {
+        m_frameBarrierTimeoutsInRow = 0;
+        if (m_frameBarrierSuspended) {
+            SpoutLogNotice("Frame barrier resumed at frame %ld", maxFrame);
+            m_frameBarrierSuspended = false;
+        }
+        return;
+    }
+    if (m_frameBarrierSuspended) {
+        return;
+    }
+
+    // Receive again on the tiles that are behind until all show the same frame.
+    // A tile can move past the others, so the target is recomputed each time.
+    m_frameBarrierWaits++;
+    uint64_t start = spoutstats::NowMicroseconds();
+    uint64_t timeout = (uint64_t)m_frameBarrierTimeoutMs * 1000;
+    bool matched = false;
+    while (spoutstats::NowMicroseconds() - start < timeout) {
+        for (auto tile = m_tiles.begin(); tile != m_tiles.end(); tile++) {
+            long tileMin = 0;
+            long tileMax = 0;
+            if ((*tile)->GetSenderFrameRange(tileMin, tileMax) && tileMin < maxFrame) {
+                (*tile)->Update();
+            }
+        }
+        if (frameRange(minFrame, maxFrame) == 0 || minFrame == maxFrame) {
+            matched = true;
+            break;
+        }
+        std::this_thread::yield();
+    }
+    m_frameBarrierWaitTime.Add(spoutstats::NowMicroseconds() - start);
+
+    if (matched) {
+        m_frameBarrierTimeoutsInRow = 0;
+        return;
+    }
+
+    // Present the frames that were received
+    m_frameBarrierTimeouts++;
+    m_frameBarrierTimeoutsInRow++;
+    if (m_frameBarrierTimeoutsInRow >= FrameBarrierMaxTimeoutsInRow) {
+        SpoutLogWarning("Frame barrier suspended, tile frame numbers %ld to %ld do not match", minFrame, maxFrame);
+        m_frameBarrierSuspended = true;
+        m_frameBarrierTimeoutsInRow = 0;
+    }
+}
+
+void
+SpoutStereoWindow::OnPresent()
+{
+    uint64_t presentTime = spoutstats::NowMicroseconds();
+    for (auto tile = m_tiles.begin(); tile != m_tiles.end(); tile++) {
+        (*tile)->OnPresent(presentTime);
+    }
+}
+
+void
+SpoutStereoWindow::WaitForFrame()
+{
+    if (framePaced()) {
+        m_framePacer.Wait();
     }
 }
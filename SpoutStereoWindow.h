@@ -5,9 +5,16 @@
 #include "SpoutDX/SpoutDX.h"
 #include "StepTimer.h"
 #include "SpoutStereoTile.h"
+#include "SpoutStereoGraphics.h"
+#include "SpoutStereoComposition.h"
+#include "SpoutStereoWorkerPool.h"
 
 #include <minvr3.h>
 
+#include <atomic>
+#include <chrono>
+#include <thread>
+
 class SpoutStereoWindow
 {
 public:
@@ -32,14 +39,40 @@ public:
 
     void Update();
     void Draw(Microsoft::WRL::ComPtr<ID3D11RenderTargetView> renderTargetViewLeft, Microsoft::WRL::ComPtr<ID3D11RenderTargetView> renderTargetViewRight);
+    HRESULT Present(IDXGISwapChain* swapChain, UINT syncInterval);
+
+    // With DAMAGE_TRACKING, false if nothing has changed since the last Draw, so
+    // that the frame can be skipped instead of drawn and presented again
+    bool NeedsDraw();
+
+    // Waits in place of the present of a skipped frame, for the frame pacer's
+    // deadline or the display's vertical blank
+    void SkipFrame(IDXGISwapChain* swapChain);
+
+    // Writes performance statistics to the Spout log
+    void LogStats();
+
+    // Waits for the deadline of the next frame when FRAME_PACER_FPS is set
+    void WaitForFrame();
+
+    // Called after the swap chain has presented, for the tiles' frame latency
+    void OnPresent();
 
-    ID3D11VertexShader* fullscreenVertexShader() {
-        return m_fullscreenVertexShader;
+    // The main loop is paced by FRAME_PACER_FPS instead of the display's vertical sync
+    bool framePaced() {
+        return m_framePacer.GetFps() > 0.0;
     }
-    ID3D11PixelShader* fullscreenPixelShader() {
-        return m_fullscreenPixelShader;
+
+    SpoutStereoGraphics* graphics() {
+        return m_graphics.get();
+    }
+
+    // GRAPHICS_BACKEND is "null", there is no D3D11 device or swap chain
+    bool headless() {
+        return m_graphicsBackend == "null";
     }
 
+    // Null when headless
     std::shared_ptr<DirectX::SpriteFont> font() {
         return m_font;
     }
@@ -57,6 +90,17 @@ public:
         return false;
     }
 
+    // Number of tiles receiving from Spout senders
+    int tilesReceiving() {
+        int count = 0;
+        for (auto tile = m_tiles.begin(); tile != m_tiles.end(); tile++) {
+            if ((*tile)->receivingFromSpout()) {
+                count++;
+            }
+        }
+        return count;
+    }
+
 
     bool requiresDeviceReset() {
         for (auto tile = m_tiles.begin(); tile != m_tiles.end(); tile++) {
@@ -77,18 +121,109 @@ public:
         return m_stereo;
     }
 
+    // Changes when a Spout sender is registered or released, 0 if not available.
+    // Read once per frame before the tiles update, which may be on other threads.
+    uint32_t senderListGeneration() {
+        return m_senderListGeneration;
+    }
+
+    // Finds the first or newest sender matching a pattern with one '*' wildcard
+    bool findSenderPattern(const std::string& pattern, bool newest, std::string& match) {
+        char name[256] = {};
+        if (!m_senderNames.FindSenderPattern(pattern.c_str(), name, 256, newest)) {
+            return false;
+        }
+        match = name;
+        return true;
+    }
+
+    // How often a tile without a sender retries when the sender list has not changed
+    std::chrono::milliseconds senderRetryInterval() {
+        return m_senderRetryInterval;
+    }
+
 protected:
     HWND m_window;
     bool m_stereo;
     bool m_lastReceivingFromSpout;
     std::vector<SpoutStereoTile*> m_tiles;
 
+    // Batch sender resolution, reads the info for all tiles' senders in one pass
+    bool m_batchSenderResolve;
+    spoutSenderNames m_senderNames;
+    std::vector<std::string> m_senderNameList;
+    std::vector<SharedTextureInfo> m_senderInfoList;
+    std::vector<bool> m_senderFoundList;
+    std::chrono::milliseconds m_senderRetryInterval;
+    uint32_t m_senderListGeneration;
+
+    // Parallel tile update, each tile receives on a worker thread and all are
+    // joined before the frame barrier and Draw
+    bool m_parallelTileUpdate;
+    SpoutStereoWorkerPool m_tileWorkers;
+    spoutLogHistogram m_tileUpdateTime;
+
+    // Resolves the senders and updates the tiles, on the receive thread if there is one
+    void receiveTiles();
+    // Writes the statistics of receiveTiles to the Spout log
+    void logReceiveStats();
+
+    // Receive thread, receives at RECEIVE_THREAD_FPS and publishes each tile's newest
+    // frame to its mailbox, so that a slow sender does not delay the present
+    void startReceiveThread();
+    void stopReceiveThread();
+    void receiveLoop();
+    bool m_receiveThreadEnabled;
+    int m_receiveThreadFps;
+    std::thread m_receiveThread;
+    std::atomic<bool> m_receiveThreadStop;
+    std::atomic<bool> m_receiveStatsRequested;
+    uint64_t m_tileFramesDrawn;
+    uint64_t m_tileFramesStale;
+
+    // Damage tracking, frames are only drawn when a tile or the window has changed
+    bool m_damageTracking;
+    bool m_damaged;
+    uint64_t m_framesDrawn;
+    uint64_t m_framesSkipped;
+
+    // Instanced composition, all tiles in each eye with one draw when their textures allow it
+    bool drawInstanced(ID3D11RenderTargetView* renderTargetViewLeft, ID3D11RenderTargetView* renderTargetViewRight);
+    std::string m_compositionMode;
+    bool m_instancedComposition;
+    SpoutStereoInstancedComposition m_compositionLeft;
+    SpoutStereoInstancedComposition m_compositionRight;
+    std::vector<SpoutStereoQuadSource> m_quadSourcesLeft;
+    std::vector<SpoutStereoQuadSource> m_quadSourcesRight;
+    uint64_t m_framesInstanced;
+    uint64_t m_framesPerTile;
+    spoutLogHistogram m_drawTime;
+
+    // Performance Statistics
+    bool m_lockStats;
+    int m_statsLogIntervalSeconds;
+    std::chrono::steady_clock::time_point m_lastStatsLogTime;
+
+    // Frame Pacing
+    spoutFramePacer m_framePacer;
+
+    // Frame Barrier, waits for all tiles to receive the same sender frame number
+    void waitForFrameBarrier();
+    bool m_frameBarrier;
+    int m_frameBarrierTimeoutMs;
+    bool m_frameBarrierSuspended;
+    int m_frameBarrierTimeoutsInRow;
+    uint64_t m_frameBarrierFrames;
+    uint64_t m_frameBarrierWaits;
+    uint64_t m_frameBarrierTimeouts;
+    spoutLogHistogram m_frameBarrierWaitTime;
+
     // Common Graphics Resources
     Microsoft::WRL::ComPtr<ID3D11Device> m_d3dDevice;
     Microsoft::WRL::ComPtr<ID3D11DeviceContext> m_d3dContext;
 
-    ID3D11VertexShader* m_fullscreenVertexShader;
-    ID3D11PixelShader* m_fullscreenPixelShader;
+    std::string m_graphicsBackend;
+    std::unique_ptr<SpoutStereoGraphics> m_graphics;
     std::shared_ptr<DirectX::SpriteFont> m_font;
     std::shared_ptr<DirectX::SpriteBatch> m_spriteBatch;
 
@@ -0,0 +1,106 @@
+#include "SpoutStereoWorkerPool.h"
+
+
+SpoutStereoWorkerPool::SpoutStereoWorkerPool() :
+    m_stop(false),
+    m_generation(0),
+    m_task(nullptr),
+    m_count(0),
+    m_next(0),
+    m_busyWorkers(0)
+{
+}
+
+SpoutStereoWorkerPool::~SpoutStereoWorkerPool()
+{
+    Stop();
+}
+
+void
+SpoutStereoWorkerPool::Start(int threads)
+{
+    Stop();
+    m_stop = false;
+    for (int i = 0; i < threads; i++) {
+        m_threads.push_back(std::thread(&SpoutStereoWorkerPool::workerLoop, this));
+    }
+}
+
+void
+SpoutStereoWorkerPool::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_workReady.notify_all();
+    for (auto thread = m_threads.begin(); thread != m_threads.end(); thread++) {
+        thread->join();
+    }
+    m_threads.clear();
+}
+
+void
+SpoutStereoWorkerPool::Run(int count, const std::function<void(int)>& task)
+{
+    if (count <= 0) {
+        return;
+    }
+    // Not worth waking the workers for one task
+    if (m_threads.empty() || count == 1) {
+        for (int i = 0; i < count; i++) {
+            task(i);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_task = &task;
+        m_count = count;
+        m_next.store(0);
+        m_busyWorkers = (int)m_threads.size();
+        m_generation++;
+    }
+    m_workReady.notify_all();
+
+    runTasks();
+
+    // The task must outlive every worker's use of it
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_workDone.wait(lock, [this] { return m_busyWorkers == 0; });
+    m_task = nullptr;
+}
+
+void
+SpoutStereoWorkerPool::workerLoop()
+{
+    uint64_t generation = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_workReady.wait(lock, [this, generation] { return m_stop || m_generation != generation; });
+            if (m_stop) {
+                return;
+            }
+            generation = m_generation;
+        }
+
+        runTasks();
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_busyWorkers--;
+        }
+        m_workDone.notify_one();
+    }
+}
+
+void
+SpoutStereoWorkerPool::runTasks()
+{
+    // Each thread takes the next index until all have been taken
+    for (int i = m_next.fetch_add(1); i < m_count; i = m_next.fetch_add(1)) {
+        (*m_task)(i);
+    }
+}
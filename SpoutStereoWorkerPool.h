@@ -0,0 +1,45 @@
+#pragma once
+
+// Only the standard library, so that the benchmarks can build it without the precompiled header
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of threads that run the iterations of a loop in parallel.
+// The calling thread runs iterations too, and Run returns when all are done.
+class SpoutStereoWorkerPool
+{
+public:
+    SpoutStereoWorkerPool();
+    virtual ~SpoutStereoWorkerPool();
+
+    // Starts the worker threads, in addition to the calling thread. 0 runs everything on the calling thread.
+    void Start(int threads);
+    void Stop();
+
+    // Calls task(i) for each i from 0 to count - 1, spread over the workers and the calling thread
+    void Run(int count, const std::function<void(int)>& task);
+
+    int threads() {
+        return (int)m_threads.size();
+    }
+
+protected:
+    void workerLoop();
+    void runTasks();
+
+    std::vector<std::thread> m_threads;
+    std::mutex m_mutex;
+    std::condition_variable m_workReady;
+    std::condition_variable m_workDone;
+    bool m_stop;
+    uint64_t m_generation; // Changes for each Run so that workers wake once per call
+    const std::function<void(int)>* m_task;
+    int m_count;
+    std::atomic<int> m_next;
+    int m_busyWorkers;
+};
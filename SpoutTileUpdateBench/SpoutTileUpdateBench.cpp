@@ -0,0 +1,228 @@
+/*
+
+	SpoutTileUpdateBench.cpp
+
+	Benchmark of the server's tile update, one tile after another and
+	in parallel as with PARALLEL_TILE_UPDATE.
+
+	Each run creates a SpoutStereoWindow with GRAPHICS_BACKEND "null" and
+	its tiles from config values set here, so the tiles' receivers open
+	their own D3D11 devices as they do in the server. A sender for each
+	eye of each tile is sent from a separate thread at a fixed rate, and
+	the window is updated at the same rate.
+
+	For 1, 2, 4 ... tiles the wall clock time of the window's Update is
+	reported, which resolves the senders and updates all tiles. The
+	parallel run uses TILE_UPDATE_THREADS of one per tile up to the number
+	of cores, including the calling thread.
+
+	Usage :
+
+		SpoutTileUpdateBench [-tiles N] [-frames F] [-size S] [-fps R]
+
+		-tiles   largest number of tiles (default 8)
+		-frames  frames measured for each run (default 600)
+		-size    width and height of the sender textures (default 1280)
+		-fps     rate of the senders and of the update (default 120)
+
+*/
+#include "pch.h"
+#include "SpoutStereoWindow.h"
+#include "SpoutFramePacer.h"
+#include "SpoutStats.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+	std::string TileName(int tile)
+	{
+		char name[32];
+		sprintf_s(name, 32, "BENCH%d", tile);
+		return name;
+	}
+
+	std::string SenderName(int tile, const char* eye)
+	{
+		char name[64];
+		sprintf_s(name, 64, "TileUpdateBench_%d_%s", tile, eye);
+		return name;
+	}
+
+	// Sets the config values read by SpoutStereoWindow::Initialize for a run
+	void Configure(int tiles, int size, int threads)
+	{
+		std::string tileNames;
+		for (int i = 0; i < tiles; i++) {
+			const std::string name = TileName(i);
+			tileNames += (i > 0 ? ", \"" : "\"") + name + "\"";
+			ConfigVal::AddOrReplace(name + "_VIEWPORT_X", std::to_string(i * size));
+			ConfigVal::AddOrReplace(name + "_VIEWPORT_Y", "0");
+			ConfigVal::AddOrReplace(name + "_VIEWPORT_WIDTH", std::to_string(size));
+			ConfigVal::AddOrReplace(name + "_VIEWPORT_HEIGHT", std::to_string(size));
+			ConfigVal::AddOrReplace(name + "_SPOUT_SENDER_NAME_LEFT", "\"" + SenderName(i, "LeftEye") + "\"");
+			ConfigVal::AddOrReplace(name + "_SPOUT_SENDER_NAME_RIGHT", "\"" + SenderName(i, "RightEye") + "\"");
+		}
+		ConfigVal::AddOrReplace("TILES", tileNames);
+		ConfigVal::AddOrReplace("GRAPHICS_BACKEND", "\"null\"");
+		ConfigVal::AddOrReplace("OPEN_MINVR_EVENT_CONNECTION", "False");
+		ConfigVal::AddOrReplace("PARALLEL_TILE_UPDATE", threads > 1 ? "True" : "False");
+		ConfigVal::AddOrReplace("TILE_UPDATE_THREADS", std::to_string(threads));
+	}
+
+	// Sends a frame from each of the senders at the rate until stopped.
+	// The senders share a device created by the first.
+	void SendLoop(int tiles, int size, int fps, std::atomic<bool>& started, std::atomic<bool>& stop)
+	{
+		std::vector<std::unique_ptr<spoutDX>> senders;
+		ID3D11Texture2D* texture = nullptr;
+		for (int i = 0; i < tiles * 2; i++) {
+			std::unique_ptr<spoutDX> sender(new spoutDX());
+			sender->OpenDirectX11(senders.empty() ? nullptr : senders[0]->GetDX11Device());
+			sender->SetSenderName(SenderName(i / 2, (i % 2 == 0) ? "LeftEye" : "RightEye").c_str());
+			senders.push_back(std::move(sender));
+		}
+
+		ID3D11Device* device = senders[0]->GetDX11Device();
+		if (device) {
+			D3D11_TEXTURE2D_DESC desc = {};
+			desc.Width = static_cast<UINT>(size);
+			desc.Height = static_cast<UINT>(size);
+			desc.MipLevels = 1;
+			desc.ArraySize = 1;
+			desc.Format = DXGI_FORMAT_B8G8R8A8_UNORM;
+			desc.SampleDesc.Count = 1;
+			desc.Usage = D3D11_USAGE_DEFAULT;
+			desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+			device->CreateTexture2D(&desc, nullptr, &texture);
+		}
+		started = true;
+
+		spoutFramePacer pacer;
+		pacer.SetFps(static_cast<double>(fps));
+		while (texture && !stop) {
+			for (auto sender = senders.begin(); sender != senders.end(); sender++)
+				(*sender)->SendTexture(texture);
+			pacer.Wait();
+		}
+
+		if (texture)
+			texture->Release();
+		// The first sender's device is released last
+		while (!senders.empty()) {
+			senders.back()->ReleaseSender();
+			senders.pop_back();
+		}
+	}
+
+	// Updates the window until every tile receives from its senders
+	bool Connect(SpoutStereoWindow& window, int tiles, int timeoutMs)
+	{
+		const uint64_t end = spoutstats::NowMicroseconds() + static_cast<uint64_t>(timeoutMs) * 1000ULL;
+		while (spoutstats::NowMicroseconds() < end) {
+			window.Update();
+			if (window.tilesReceiving() == tiles)
+				return true;
+			Sleep(10);
+		}
+		return false;
+	}
+
+	// Updates the window once per frame
+	void RunUpdate(SpoutStereoWindow& window, int frames, int fps, spoutLogHistogram& updateTime)
+	{
+		spoutFramePacer pacer;
+		pacer.SetFps(static_cast<double>(fps));
+		pacer.Wait(); // Start of the schedule
+
+		for (int frame = 0; frame < frames; frame++) {
+			const uint64_t start = spoutstats::NowMicroseconds();
+			window.Update();
+			updateTime.Add(spoutstats::NowMicroseconds() - start);
+			pacer.Wait();
+		}
+	}
+
+	// Runs the benchmark for a number of tiles on a window configured for the threads
+	void Run(HWND hwnd, int tiles, int size, int frames, int fps, int threads)
+	{
+		Configure(tiles, size, threads);
+		std::unique_ptr<SpoutStereoWindow> window(new SpoutStereoWindow());
+		window->Initialize(hwnd, true);
+		window->CreateDeviceResources(nullptr, nullptr);
+		window->CreateWindowResources();
+
+		if (Connect(*window, tiles, 5000)) {
+			spoutLogHistogram updateTime;
+			RunUpdate(*window, frames, fps, updateTime);
+			printf("%5d  %7d  %8.0f  %7llu  %7llu  %7llu\n",
+				tiles, threads, updateTime.Mean(),
+				updateTime.Percentile(50.0), updateTime.Percentile(99.0), updateTime.Max());
+		}
+		else {
+			printf("%5d  %7d  tiles did not connect to the senders\n", tiles, threads);
+		}
+
+		window->ReleaseWindowResources();
+		window->ReleaseDeviceResources();
+	}
+
+	int ArgValue(int argc, char* argv[], const char* option, int defaultValue, int minValue, int maxValue)
+	{
+		for (int i = 1; i < argc - 1; i++) {
+			if (strcmp(argv[i], option) == 0) {
+				int value = atoi(argv[i + 1]);
+				if (value < minValue) value = minValue;
+				if (value > maxValue) value = maxValue;
+				return value;
+			}
+		}
+		return defaultValue;
+	}
+
+}
+
+int main(int argc, char* argv[])
+{
+	const int maxTiles = ArgValue(argc, argv, "-tiles", 8, 1, 64);
+	const int frames = ArgValue(argc, argv, "-frames", 600, 1, 1000000);
+	const int size = ArgValue(argc, argv, "-size", 1280, 16, 16384);
+	const int fps = ArgValue(argc, argv, "-fps", 120, 1, 1000);
+	const int cores = static_cast<int>(std::thread::hardware_concurrency());
+
+	// The window's keyboard and mouse need a window, which is never shown
+	HWND hwnd = CreateWindowExW(0, L"STATIC", L"SpoutTileUpdateBench", 0, 0, 0, 0, 0,
+		HWND_MESSAGE, nullptr, GetModuleHandleW(nullptr), nullptr);
+
+	printf("Spout tile update benchmark - %d frames per run, %dx%d senders at %d fps, %d cores\n", frames, size, size, fps, cores);
+	printf("Times in microseconds of the window's Update. Percentiles are the upper bound of a power of two bucket.\n\n");
+	printf("%5s  %7s  %8s  %7s  %7s  %7s\n", "tiles", "threads", "mean", "p50", "p99", "max");
+
+	for (int tileCount = 1; tileCount <= maxTiles; tileCount *= 2) {
+		std::atomic<bool> started(false);
+		std::atomic<bool> stop(false);
+		std::thread sendThread(SendLoop, tileCount, size, fps, std::ref(started), std::ref(stop));
+		while (!started)
+			Sleep(1);
+
+		Run(hwnd, tileCount, size, frames, fps, 1);
+		const int threads = (tileCount < cores) ? tileCount : cores;
+		if (threads > 1)
+			Run(hwnd, tileCount, size, frames, fps, threads);
+
+		stop = true;
+		sendThread.join();
+	}
+
+	DestroyWindow(hwnd);
+	return 0;
+}